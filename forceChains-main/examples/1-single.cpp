@@ -3,8 +3,10 @@ This example finds force chains for one time step of LIGGGHTS files.
 Unzip the files in liggghtsResult.tar.xz in build folder and run
 the program.
 
-Always make sure the format and order of columns in your results are
-the same as the files in the tar archive. The tar file also includes
+Always make sure the format and order of columns in your pair results
+are the same as the files in the tar archive. The particle dumps may
+have any columns in any order, as long as id, x, y, z and radius are
+among them, they are found from the "ITEM: ATOMS" header. The tar file also includes
 an input script for liggghts, so the user can create similar results
 digestable by this program.
 
@@ -80,6 +82,9 @@ int main()
     // Inject the file names and the maximum angle for force chains
     UserInterface ui(particleFile, pairFile, pairWall, alpha);
 
+    // Report reading throughput of the pair file
+    ui.verbose = true;
+
     // Calculate force chains
     ui.Run();
 
@@ -0,0 +1,51 @@
+/*
+Ensure studying 1-single.cpp and 3-batch.cpp, before running this example.
+This follows force chains of the files of liggghtsResult/batch_compression_2d
+from frame to frame with ChainTracker. Chains of consecutive frames are
+matched by the LIGGGHTS ids of particles they share, so each chain gets a
+track that lives while the chain does.
+
+For every time step it reports the number of chains, tracks, and the
+births, deaths, splits and merges of chains since the previous frame.
+The tracks and their lifetimes, and all events, are written in
+tracks.csv and events.csv next to post.
+
+Here, it is assumed executables are in build folder.
+*/
+#include "userInterface.h"
+#include "chainTracker.h"
+#include "fileNameCreator.h"
+using namespace std;
+using namespace ForceChain;
+
+int main()
+{
+    std::string path = "../liggghtsResult/batch_compression_2d/";
+    int start = 0, last = 4000, step = 500;
+    auto particleNames = CreateNumericFileName(path + "post/compress", ".liggghts", start, last, step);
+    auto pairNames = CreateNumericFileName(path + "post/pair", ".txt", start, last, step);
+
+    // Chains overlap if they share half of the shorter one.
+    ChainTracker tracker(0.5);
+
+    cout << "timestep  chains  tracks  births  deaths  splits  merges\n";
+    for (size_t i = 0; i < particleNames.size(); i++)
+    {
+        auto timestep = start + i * step;
+        UserInterface ui(particleNames[i], pairNames[i], "", M_PI_4);
+        ui.Run();
+
+        auto eventsCount = tracker.events.size();
+        tracker.AddFrame(ui.particles, ui.chains, timestep);
+
+        size_t counts[4] = {0, 0, 0, 0};
+        for (auto iEvent = eventsCount; iEvent < tracker.events.size(); iEvent++)
+            counts[int(tracker.events[iEvent].type)]++;
+        cout << timestep << "  " << ui.chains.size() << "  " << tracker.tracks.size()
+             << "  " << counts[int(ChainEventType::Birth)] << "  " << counts[int(ChainEventType::Death)]
+             << "  " << counts[int(ChainEventType::Split)] << "  " << counts[int(ChainEventType::Merge)] << "\n";
+    }
+
+    tracker.WriteTracksCsv(path + "tracks.csv", true, ",");
+    tracker.WriteEventsCsv(path + "events.csv", true, ",");
+}
@@ -6,6 +6,8 @@ Here we only accept chains that are within a box and have at least one
 particle with MinorStress>stress_threshold.
 
 Stat (statistics) class applies the filters and calculates the statistics. 
+The same selection is then made by one filter expression, which is
+faster when many combinations of filters are tested on a frame.
 */
 #include "userInterface.h"
 #include "fileNameCreator.h"
@@ -56,4 +58,14 @@ int main()
     <<"Max Length: " << ui.stat.GetMaxChainLength() <<"\n"
     <<"Min Length: " << ui.stat.GetMinChainLength() <<"\n"
     <<"Median Length: " << ui.stat.GetMedianChainLength() <<"\n";
+
+    // Filters combined by &&, || and !, see FilterExpression. Chains
+    // with any particle above the threshold and all within the box,
+    // as above, and those out of the box for comparison.
+    ui.stat.ResetSamples();
+    ui.stat.ApplyFilter(AnyOf(filter) && AllOf(boxFilter));
+    cout << "num of chains of the expression: " << ui.stat.GetChainsCount() << "\n";
+
+    auto outOfBox = ui.stat.SelectChains(AnyOf(filter) && !AnyOf(boxFilter));
+    cout << "num of chains out of the box: " << outOfBox.Count() << "\n";
 }
\ No newline at end of file
@@ -11,6 +11,7 @@ run this for all of them.
 The path variable must be the folder of your liggghts results.
 */
 #include "userInterface.h"
+#include "batchPipeline.h"
 #include "fileNameCreator.h"
 using namespace std;
 using namespace ForceChain;
@@ -80,16 +81,29 @@ int main()
     // output files
     auto chainNames = CreateNumericFileName(outputPath + "forceChains_", "", start, last, step);
 
-    for (size_t i = 0; i < d_names.size(); i++)
+    // Reads the next files while chains of this one are found and
+    // the previous ones are written. Larger depths smooth out uneven
+    // files but keep more frames in memory.
+    BatchPipeline pipeline(2);
+
+    pipeline.Run(d_names.size(), [&](size_t i)
     {
         // Write name of file being processed.
         auto percent = i * 100. / d_names.size();
         cout <<"\r"<< d_names[i] + "  " << setiosflags(ios::fixed) << setprecision(0) << percent << "%"<<flush;
         
-        UserInterface ui(d_names[i], pairNames[i], wallNames[i], alpha);
-        ui.Run();
+        auto ui = make_unique<UserInterface>(d_names[i], pairNames[i], wallNames[i], alpha);
+
+        // Uncomment to keep a binary snapshot of each frame in the
+        // output directory, so running the batch again, e.g. with
+        // another alpha, skips reading the files and the stress analysis.
+        //ui->EnableSnapshotCache(chainNames[i] + ".snapshot");
 
+        return ui;
+    },
+    [&](size_t i, UserInterface &ui)
+    {
         ui.WriteChainsCsv(chainNames[i]+".csv", true, ",");
         //ui.WriteChainsVtp(chainNames[i] + ".vtp");
-    }
-}
\ No newline at end of file
+    });
+}
@@ -9,6 +9,7 @@ The box is moved in x-axis after some delay with constant speed.
 
 */
 #include "userInterface.h"
+#include "batchPipeline.h"
 #include "fileNameCreator.h"
 #include "sectionFilter.h"
 using namespace std;
@@ -28,7 +29,10 @@ int main()
     auto d_names = CreateNumericFileName(path + "compress", ".liggghts", start, last, step);
     auto pairNames = CreateNumericFileName(path + "pair", ".txt", start, last, step);
 
-    auto wallNames = CreateNumericFileName(path + "wall_pair", ".txt", start, last, step);
+    // Wall files can be text, compressed (.gz, .zst) or LIGGGHTS binary
+    // dumps, whose names end with .bin
+    auto binaryWalls = false;
+    auto wallNames = CreateNumericFileName(path + "wall_pair", binaryWalls ? ".bin" : ".txt", start, last, step);
 
     // Set all elements of wallNames to empty strings if there are no stl files (or else comment this part out)
     for (auto& name : wallNames)
@@ -47,16 +51,20 @@ int main()
     auto boxDelay = 0;
     auto boxSpeed = 0.00275;
 
-    for (size_t i = 0; i < d_names.size(); i++)
+    // Reads the next files while chains of this one are found and
+    // the previous ones are written.
+    BatchPipeline pipeline(2);
+
+    pipeline.Run(d_names.size(), [&](size_t i)
     {
         // Write name of file being processed.
         auto percent = i * 100. / d_names.size();
         cout <<"\r"<< d_names[i] + "  " << setiosflags(ios::fixed) << setprecision(0) << percent << "%"<<flush;
       
-        UserInterface ui(d_names[i], pairNames[i], wallNames[i], M_PI_4);
-
-        ui.Run();
-
+        return make_unique<UserInterface>(d_names[i], pairNames[i], wallNames[i], M_PI_4);
+    },
+    [&](size_t i, UserInterface &ui)
+    {
         auto xBox = xBox0;
         if (i > boxDelay)
             xBox = xBox0 + (i - boxDelay) * boxSpeed;
@@ -69,5 +77,5 @@ int main()
         ui.stat.ApplyFilterAll(boxFilter);
 
         ui.chainsIo.WriteFilteredVtp(outputNames[i]+".vtp", ui.stat.GetSampleChainIds());
-    }
+    });
 }
\ No newline at end of file
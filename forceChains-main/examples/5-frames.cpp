@@ -0,0 +1,61 @@
+/* 
+Ensure studying 1-single.cpp and 3-batch.cpp first, then use this.
+Long LIGGGHTS runs can write all time steps in one dump file, i.e. the
+dump file name has no "*" and the file holds many "ITEM: TIMESTEP" blocks.
+This example finds force chains of such files frame by frame, without
+splitting them on disk. Only the frame being processed is kept in memory.
+
+The liggghts files for this example are not provided. They can be made
+from the ones in batch_compression_2d by joining them, e.g.
+cat compress*.liggghts > compress.liggghts
+cat pair*.txt > pair.txt
+*/
+#include "userInterface.h"
+using namespace std;
+using namespace ForceChain;
+
+int main()
+{
+    // Where the liggghts files placed.
+    std::string path = "../liggghtsResult/batch_compression_2d/post/";
+
+    // input files with many time steps
+    std::string particleFile = path + "compress.liggghts";
+    std::string pairFile = path + "pair.txt";
+    std::string pairWall = "";
+
+    UserInterface ui(particleFile, pairFile, pairWall, M_PI_4);
+
+    // Consecutive frames share most contacts. Only the contacts that
+    // changed update the stresses, and principle stresses are solved
+    // again only for particles whose stress moved more than 0.1%.
+    ui.incrementalStress = make_shared<IncrementalStress>(1e-3);
+
+    // Chains are searched again only where particles changed since
+    // the previous frame, the rest keep their chains. Giving true
+    // checks every frame against a full search, for tests.
+    ui.incrementalChains = make_shared<IncrementalChains>();
+
+    // The chains of each frame are written once the frame is done.
+    ui.RunFrames([&](size_t timestep)
+                 {
+        cout << "timestep " << timestep << ": " << ui.chains.size() << " chains\n";
+        ui.WriteChainsCsv(path + "../forceChains_" + to_string(timestep) + ".csv", true, ","); });
+
+    // Frames can also be picked by their timestep. The index
+    // holds the byte offset of each timestep in the file.
+    DumpFrames particlesFrames(particleFile);
+    DumpFrames pairFrames(pairFile);
+    particlesFrames.BuildIndex();
+    pairFrames.BuildIndex();
+
+    std::string_view particlesFrame, pairFrame;
+    size_t timestep;
+    if (particlesFrames.Seek(2000) && pairFrames.Seek(2000) &&
+        particlesFrames.Next(particlesFrame, timestep) &&
+        pairFrames.Next(pairFrame, timestep))
+    {
+        ui.RunFrame(particlesFrame, pairFrame);
+        ui.WriteChainsVtp(path + "../forceChains_2000.vtp");
+    }
+}
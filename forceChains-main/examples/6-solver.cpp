@@ -0,0 +1,127 @@
+/*
+Ensure studying 1-single.cpp, before running this example.
+This compares the batched symmetric solver of principle stresses
+(UserInterface::symmetricStress) with the general eigen solver
+of each particle, on the files of liggghtsResult.
+
+For every time step it reports:
+ - the largest error of the batched solver against the general solver
+   given the same, symmetric, stresses: principle stresses relative to
+   the largest one, and the angle between minor directions,
+ - how much symmetric stresses change the results of the general solver
+   on the stresses as they are: the angle between minor directions and
+   the number of chains found with alpha = pi/4,
+ - the time of both solvers and the speedup.
+
+Here, it is assumed executables are in build folder.
+*/
+#include "userInterface.h"
+#include "fileNameCreator.h"
+#include <chrono>
+using namespace std;
+using namespace ForceChain;
+
+// Largest errors of the minor direction and of the principle stresses,
+// sorted, of particles b to those of particles a.
+auto CompareSolvers(const Particles &a, const Particles &b)
+{
+    double maxAngle = 0, maxStressError = 0;
+    size_t minorMismatches = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].hasMinorStress != b[i].hasMinorStress)
+        {
+            minorMismatches++;
+            continue;
+        }
+
+        Eigen::Vector3d stressesA = a[i].GetRealPrincipleStresses();
+        Eigen::Vector3d stressesB = b[i].GetRealPrincipleStresses();
+        sort(stressesA.begin(), stressesA.end());
+        sort(stressesB.begin(), stressesB.end());
+        auto scale = max(stressesA.cwiseAbs().maxCoeff(), 1e-300);
+        maxStressError = max(maxStressError, (stressesA - stressesB).cwiseAbs().maxCoeff() / scale);
+
+        if (a[i].hasMinorStress)
+        {
+            // Directions have no sign.
+            auto cosine = min(1., abs(a[i].minorDir.dot(b[i].minorDir)));
+            maxAngle = max(maxAngle, acos(cosine));
+        }
+    }
+    return make_tuple(maxStressError, maxAngle * 180 / M_PI, minorMismatches);
+}
+
+// Runs solve and returns its time in seconds, the best of some runs.
+template <typename Solve>
+double Time(Solve solve)
+{
+    double best = numeric_limits<double>::max();
+    for (int run = 0; run < 5; run++)
+    {
+        auto startTime = chrono::steady_clock::now();
+        solve();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main()
+{
+    std::string path = "../liggghtsResult/";
+    auto particleNames = CreateNumericFileName(path + "batch_compression_2d/post/compress", ".liggghts", 0, 4000, 500);
+    auto pairNames = CreateNumericFileName(path + "batch_compression_2d/post/pair", ".txt", 0, 4000, 500);
+    particleNames.push_back(path + "fabricated/test_1.liggghts");
+    pairNames.push_back(path + "fabricated/pair_test_1.txt");
+
+    cout << "file  particles  stressError  minorAngleError(deg)  minorMismatches"
+            "  asymmetricMinorAngle(deg)  chains(general symmetric)"
+            "  generalTime(s)  batchedTime(s)  speedup\n";
+
+    double generalTotal = 0, batchedTotal = 0;
+    for (size_t i = 0; i < particleNames.size(); i++)
+    {
+        auto particles = ReadParticles(particleNames[i]);
+        ReadPairParallel(particles, pairNames[i]);
+
+        // The general solver as used by default.
+        auto general = particles;
+        auto generalTime = Time([&]
+                                {
+            for (auto particle : general)
+                particle.setPrincipleStressAndDir(); });
+
+        // The general solver on symmetric stresses, the reference.
+        auto reference = particles;
+        for (auto particle : reference)
+        {
+            // eval() as the result overwrites its own input
+            particle.stress = (particle.stress + particle.stress.transpose()).eval() / 2.;
+            particle.setPrincipleStressAndDir();
+        }
+
+        auto batched = particles;
+        auto batchedTime = Time([&]
+                                { SetSymmetricPrincipleStresses(batched); });
+
+        auto [stressError, angleError, mismatches] = CompareSolvers(reference, batched);
+        auto asymmetricAngle = get<1>(CompareSolvers(general, batched));
+
+        UserInterface ui(particleNames[i], pairNames[i], "", M_PI_4);
+        ui.Run();
+        auto generalChains = ui.chains.size();
+        ui.symmetricStress = true;
+        ui.Run();
+        auto symmetricChains = ui.chains.size();
+
+        generalTotal += generalTime;
+        batchedTotal += batchedTime;
+        cout << particleNames[i] << "  " << particles.size() << "  " << stressError << "  " << angleError
+             << "  " << mismatches << "  " << asymmetricAngle
+             << "  " << generalChains << " " << symmetricChains
+             << "  " << generalTime << "  " << batchedTime << "  " << generalTime / batchedTime << "\n";
+    }
+
+    cout << "Total speedup: " << generalTotal / batchedTotal << "\n";
+}
@@ -0,0 +1,127 @@
+/*
+Ensure studying 1-single.cpp, before running this example.
+This compares the single precision pipeline (UserInterfaceF, whose
+particles are ParticleF) with the double one (UserInterface), on the
+files of liggghtsResult. Contacts are read and their stresses summed
+in double by both, the float one rounds the sums once per particle.
+
+For every time step and alpha it reports:
+ - the largest error of float minor stresses relative to the largest
+   double one, and the largest angle between minor directions,
+ - the number of chains and of particles in chains of both,
+ - particles in chains of one precision only, their share of the
+   particles in chains of double,
+ - the time of both runs.
+
+Here, it is assumed executables are in build folder.
+*/
+#include "userInterface.h"
+#include "fileNameCreator.h"
+#include <chrono>
+using namespace std;
+using namespace ForceChain;
+
+// Largest error of minor stresses of b, relative to the largest one
+// of a, and the largest angle between minor directions in degree.
+template <typename ScalarA, typename ScalarB>
+auto CompareMinorStresses(const BasicParticles<ScalarA> &a, const BasicParticles<ScalarB> &b)
+{
+    double maxMinorStress = 1e-300;
+    for (auto particle : a)
+        maxMinorStress = max(maxMinorStress, abs(double(particle.minorStress)));
+
+    double maxError = 0, maxAngle = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (!a[i].hasMinorStress || !b[i].hasMinorStress)
+            continue;
+        maxError = max(maxError, abs(double(a[i].minorStress) - double(b[i].minorStress)) / maxMinorStress);
+
+        // Directions have no sign.
+        Eigen::Vector3d dirA = a[i].minorDir.template cast<double>();
+        Eigen::Vector3d dirB = b[i].minorDir.template cast<double>();
+        auto cosine = min(1., abs(dirA.dot(dirB)) / (dirA.norm() * dirB.norm()));
+        maxAngle = max(maxAngle, acos(cosine));
+    }
+    return make_tuple(maxError, maxAngle * 180 / M_PI);
+}
+
+// Whether each particle is in a chain. Particles of both precisions
+// are in the same order, by id.
+template <typename Scalar>
+auto GetIsInChain(const BasicParticles<Scalar> &particles)
+{
+    vector<bool> isInChain(particles.size(), false);
+    for (size_t i = 0; i < particles.size(); i++)
+        isInChain[i] = particles[i].chainId >= 0;
+    return isInChain;
+}
+
+// Runs work and returns its time in seconds.
+template <typename Work>
+double Time(Work work)
+{
+    auto startTime = chrono::steady_clock::now();
+    work();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+    return elapsed.count();
+}
+
+int main()
+{
+    std::string path = "../liggghtsResult/";
+    auto particleNames = CreateNumericFileName(path + "batch_compression_2d/post/compress", ".liggghts", 0, 4000, 500);
+    auto pairNames = CreateNumericFileName(path + "batch_compression_2d/post/pair", ".txt", 0, 4000, 500);
+    particleNames.push_back(path + "fabricated/test_1.liggghts");
+    pairNames.push_back(path + "fabricated/pair_test_1.txt");
+
+    cout << "Bytes of a particle, double: " << Particles::bytesPerParticle << ", float: " << ParticlesF::bytesPerParticle << "\n";
+    cout << "file  alpha  minorStressError  minorAngleError(deg)  chains(double float)"
+            "  chainParticles(double float)  onlyDouble  onlyFloat  differentShare"
+            "  doubleTime(s)  floatTime(s)\n";
+
+    size_t allDifferent = 0, allChainParticles = 0;
+    for (size_t i = 0; i < particleNames.size(); i++)
+    {
+        for (auto alpha : {M_PI_4, M_PI / 8})
+        {
+            UserInterface ui(particleNames[i], pairNames[i], "", alpha);
+            UserInterfaceF uiF(particleNames[i], pairNames[i], "", alpha);
+            auto doubleTime = Time([&]
+                                   { ui.Load(); });
+            auto floatTime = Time([&]
+                                  { uiF.Load(); });
+
+            // Before chains are found, which flips minor directions.
+            auto [stressError, angleError] = CompareMinorStresses(ui.particles, uiF.particles);
+
+            doubleTime += Time([&]
+                               { ui.FindChains(); });
+            floatTime += Time([&]
+                              { uiF.FindChains(); });
+
+            auto inChain = GetIsInChain(ui.particles);
+            auto inChainF = GetIsInChain(uiF.particles);
+            size_t chainParticles = 0, chainParticlesF = 0, onlyDouble = 0, onlyFloat = 0;
+            for (size_t id = 0; id < inChain.size(); id++)
+            {
+                chainParticles += inChain[id];
+                chainParticlesF += inChainF[id];
+                onlyDouble += inChain[id] && !inChainF[id];
+                onlyFloat += !inChain[id] && inChainF[id];
+            }
+            auto differentShare = double(onlyDouble + onlyFloat) / max<size_t>(chainParticles, 1);
+            allDifferent += onlyDouble + onlyFloat;
+            allChainParticles += chainParticles;
+
+            cout << particleNames[i] << "  " << alpha << "  " << stressError << "  " << angleError
+                 << "  " << ui.chains.size() << " " << uiF.chains.size()
+                 << "  " << chainParticles << " " << chainParticlesF
+                 << "  " << onlyDouble << "  " << onlyFloat << "  " << differentShare
+                 << "  " << doubleTime << "  " << floatTime << "\n";
+        }
+    }
+
+    cout << "Particles in chains of one precision only: " << allDifferent << " of "
+         << allChainParticles << " in chains of double\n";
+}
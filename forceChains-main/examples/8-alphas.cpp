@@ -0,0 +1,50 @@
+/*
+Ensure studying 1-single.cpp and 3-batch.cpp, before running this example.
+This finds force chains of the files of liggghtsResult/batch_compression_2d
+for several alphas at once, with RunAlphas. Each frame is read and its
+stresses analysed once, then chains of every alpha are found from the
+same angles of contacts. The chains are written in the alpha_pi_N
+folders next to post, as forceChains_<timestep>.csv.
+
+For every time step and alpha it reports the number of chains and
+their min, max, average and median lengths.
+
+Here, it is assumed executables are in build folder.
+*/
+#include "userInterface.h"
+#include "fileNameCreator.h"
+#include <iomanip>
+using namespace std;
+using namespace ForceChain;
+
+int main()
+{
+    std::string path = "../liggghtsResult/batch_compression_2d/";
+    int start = 0, last = 4000, step = 500;
+    auto particleNames = CreateNumericFileName(path + "post/compress", ".liggghts", start, last, step);
+    auto pairNames = CreateNumericFileName(path + "post/pair", ".txt", start, last, step);
+
+    // alpha = pi / N, and the folder of its chains.
+    vector<int> divisors{2, 4, 6, 8};
+    vector<double> alphas;
+    for (auto divisor : divisors)
+        alphas.push_back(M_PI / divisor);
+
+    cout << "timestep  alpha  chains  minLength  maxLength  averageLength  medianLength\n";
+    for (size_t i = 0; i < particleNames.size(); i++)
+    {
+        auto timestep = start + i * step;
+        UserInterface ui(particleNames[i], pairNames[i], "", alphas[0]);
+
+        size_t iAlpha = 0;
+        ui.RunAlphas(alphas, [&](double alpha)
+                     {
+            auto outputPath = path + "alpha_pi_" + to_string(divisors[iAlpha++]) + "/";
+            ui.WriteChainsCsv(outputPath + "forceChains_" + to_string(timestep) + ".csv", true, ",");
+
+            auto summary = ui.GetStat().GetSummary();
+            cout << timestep << "  " << setprecision(4) << alpha << "  " << summary.chainsCount
+                 << "  " << summary.minLength << "  " << summary.maxLength
+                 << "  " << summary.averageLength << "  " << summary.medianLength << "\n"; });
+    }
+}
@@ -0,0 +1,61 @@
+/*
+Ensure studying 1-single.cpp, before running this example.
+This finds force chains of a frame with TiledChainFinder, which reads
+the frame one spatial tile at a time, so that frames bigger than the
+memory can be analysed. memoryBudget is set small here to split the
+frame of liggghtsResult into many tiles.
+
+The chains are the same as those of UserInterface, this compares the
+CSV files written by both and reports the time of both runs.
+
+Here, it is assumed executables are in build folder.
+*/
+#include "userInterface.h"
+#include "tiledChainFinder.h"
+#include <chrono>
+#include <sstream>
+using namespace std;
+using namespace ForceChain;
+
+// Runs work and returns its time in seconds.
+template <typename Work>
+double Time(Work work)
+{
+    auto startTime = chrono::steady_clock::now();
+    work();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+    return elapsed.count();
+}
+
+auto ReadFile(string fileName)
+{
+    ifstream file(fileName);
+    stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+int main()
+{
+    std::string path = "../liggghtsResult/batch_compression_2d/post/";
+    auto particlesFile = path + "compress4000.liggghts";
+    auto pairFile = path + "pair4000.txt";
+
+    UserInterface ui(particlesFile, pairFile, "", M_PI_4);
+    auto time = Time([&]
+                     { ui.Run(); });
+    ui.WriteChainsCsv(path + "forceChains.csv", true, ",");
+
+    TiledChainFinder tiled(particlesFile, pairFile, "", M_PI_4);
+    // Bytes of a tile with its halo, a few tens of particles here.
+    tiled.memoryBudget = 100000;
+    tiled.verbose = true;
+    auto tiledTime = Time([&]
+                          { tiled.Run(); });
+    tiled.WriteChainsCsv(path + "forceChains_tiled.csv", true, ",");
+
+    auto isSame = ReadFile(path + "forceChains.csv") == ReadFile(path + "forceChains_tiled.csv");
+    cout << "Chains: " << ui.chains.size() << ", tiled: " << tiled.chains.size()
+         << (isSame ? ", the CSV files are the same" : ", the CSV files differ") << "\n";
+    cout << "Time: " << time << " s, tiled: " << tiledTime << " s\n";
+}
@@ -0,0 +1,135 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHPIPELINE_H
+#define BATCHPIPELINE_H
+
+#include "userInterface.h"
+#include "boundedQueue.h"
+#include <memory>
+#include <thread>
+#include <exception>
+#include <utility>
+
+namespace ForceChain
+{
+    // Runs a batch of frames in three stages that overlap in time:
+    // a reader thread loads frame i+1 while chains of frame i are
+    // found and a writer thread writes frame i-1. Frames are written
+    // in the order they are given.
+    //
+    // Between the stages at most queueDepth frames wait, so no more
+    // than 2*queueDepth+3 frames are in memory at once, whatever the
+    // length of the batch.
+    class BatchPipeline
+    {
+    public:
+        // Frames a stage may get ahead of the next stage.
+        size_t queueDepth = 1;
+
+        BatchPipeline(size_t queueDepth_ = 1) : queueDepth(queueDepth_) {}
+
+        // For i in [0, framesCount):
+        //   makeFrame(i) returns a std::unique_ptr<UserInterface>, or
+        //   UserInterfaceF, of frame i, called on the reader thread
+        //   before Load,
+        //   onChains(i, ui) is called on the writer thread after the
+        //   chains of frame i are found, to write or study them.
+        // The first exception of any stage stops the batch and is
+        // thrown again here.
+        template <typename MakeFrame, typename OnChains>
+        void Run(size_t framesCount, MakeFrame makeFrame, OnChains onChains)
+        {
+            using Interface = typename decltype(makeFrame(size_t(0)))::element_type;
+            using Frame = std::pair<size_t, std::unique_ptr<Interface>>;
+
+            BoundedQueue<Frame> loaded(queueDepth);
+            BoundedQueue<Frame> found(queueDepth);
+            std::exception_ptr readError, findError, writeError;
+
+            std::thread reader([&]
+                               {
+                try
+                {
+                    for (size_t i = 0; i < framesCount; i++)
+                    {
+                        std::unique_ptr<Interface> ui = makeFrame(i);
+                        ui->Load();
+                        if (!loaded.Push({i, std::move(ui)}))
+                            break;
+                    }
+                }
+                catch (...)
+                {
+                    readError = std::current_exception();
+                }
+                loaded.Close(); });
+
+            std::thread writer([&]
+                               {
+                try
+                {
+                    Frame frame;
+                    while (found.Pop(frame))
+                    {
+                        onChains(frame.first, *frame.second);
+                        frame.second.reset();
+                    }
+                }
+                catch (...)
+                {
+                    writeError = std::current_exception();
+                }
+                // Stops the stages before this one, if this failed.
+                found.Close();
+                loaded.Close(); });
+
+            try
+            {
+                Frame frame;
+                while (loaded.Pop(frame))
+                {
+                    frame.second->FindChains();
+                    if (!found.Push(std::move(frame)))
+                        break;
+                }
+            }
+            catch (...)
+            {
+                findError = std::current_exception();
+                loaded.Close();
+            }
+            found.Close();
+
+            reader.join();
+            writer.join();
+
+            for (auto &error : {readError, findError, writeError})
+            {
+                if (error)
+                    std::rethrow_exception(error);
+            }
+        }
+    };
+}
+
+#endif // BATCHPIPELINE_H
@@ -0,0 +1,189 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARYDUMP_H
+#define BINARYDUMP_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "mappedFile.h"
+#include "byteReader.h"
+
+namespace ForceChain
+{
+    // LIGGGHTS/LAMMPS write a dump in binary format if its file name
+    // ends with .bin
+    bool IsBinaryDump(const std::string &fileName)
+    {
+        return fileName.ends_with(".bin");
+    }
+
+    // One frame of a binary dump. Every column is stored as a double,
+    // ids too. values holds the rows one after the other.
+    struct BinaryDumpFrame
+    {
+        int64_t timestep = 0;
+        // Number of rows: atoms or entries
+        size_t count = 0;
+        std::vector<double> low_bound = std::vector<double>(3);
+        std::vector<double> upp_bound = std::vector<double>(3);
+        // Only newer LAMMPS versions write column names.
+        std::string columnNames;
+        size_t columnsCount = 0;
+        std::vector<double> values;
+
+        const double *Row(size_t iRow) const
+        {
+            return values.data() + iRow * columnsCount;
+        }
+    };
+
+    // Reads the frames of a binary "dump custom" or "dump local" file
+    // in order. Both layouts are accepted:
+    // - older LIGGGHTS/LAMMPS: timestep, count, triclinic, boundary,
+    //   box, columns count, chunks count, then chunks of doubles.
+    // - newer LAMMPS: the same after a magic string, byte order and
+    //   revision, and with unit style, time and column names before
+    //   chunks count.
+    class BinaryDumpFile
+    {
+        MappedFile file;
+        ByteReader reader;
+        std::string fileName;
+
+        void Fail()
+        {
+            throw std::runtime_error("\n Error: The below binary dump is broken or truncated:\n" + fileName);
+        }
+
+        template <typename T>
+        void Read(T &value)
+        {
+            if (!reader.Read(value))
+                Fail();
+        }
+
+        void Skip(size_t size)
+        {
+            if (!reader.Skip(size))
+                Fail();
+        }
+
+    public:
+        BinaryDumpFile(std::string fileName_)
+            : file(fileName_), reader(file.View()), fileName(fileName_) {}
+
+        // Reads the next frame. Returns false at the end of file.
+        bool Next(BinaryDumpFrame &frame)
+        {
+            if (reader.AtEnd())
+                return false;
+
+            int64_t first;
+            Read(first);
+
+            bool hasMagic = first < 0;
+            int revision = 0;
+            if (hasMagic)
+            {
+                // e.g. "DUMPCUSTOM"
+                Skip(-first);
+                int byteOrder;
+                Read(byteOrder);
+                if (byteOrder != 1)
+                    throw std::runtime_error("\n Error: The below binary dump has another byte order:\n" + fileName);
+                Read(revision);
+                Read(frame.timestep);
+            }
+            else
+                frame.timestep = first;
+
+            // Written as a signed 64 bit integer
+            int64_t count;
+            Read(count);
+            if (count < 0)
+                Fail();
+            frame.count = count;
+
+            int triclinic;
+            int boundary[6];
+            Read(triclinic);
+            Read(boundary);
+            for (size_t dim = 0; dim < 3; dim++)
+            {
+                Read(frame.low_bound[dim]);
+                Read(frame.upp_bound[dim]);
+            }
+            // xy, xz, yz tilts are not used
+            if (triclinic)
+                Skip(3 * sizeof(double));
+
+            int columnsCount;
+            Read(columnsCount);
+            if (columnsCount <= 0)
+                Fail();
+            frame.columnsCount = columnsCount;
+
+            frame.columnNames.clear();
+            if (hasMagic && revision > 1)
+            {
+                int unitStyleLength;
+                Read(unitStyleLength);
+                Skip(unitStyleLength);
+
+                char hasTime;
+                Read(hasTime);
+                if (hasTime)
+                    Skip(sizeof(double));
+
+                int columnNamesLength;
+                Read(columnNamesLength);
+                frame.columnNames.resize(columnNamesLength);
+                if (!reader.Read(frame.columnNames.data(), columnNamesLength))
+                    Fail();
+            }
+
+            // A chunk per writing processor
+            int chunksCount;
+            Read(chunksCount);
+            frame.values.resize(frame.count * frame.columnsCount);
+            size_t filled = 0;
+            for (int iChunk = 0; iChunk < chunksCount; iChunk++)
+            {
+                int chunkSize;
+                Read(chunkSize);
+                if (chunkSize < 0 || filled + chunkSize > frame.values.size() ||
+                    !reader.Read(frame.values.data() + filled, chunkSize))
+                    Fail();
+                filled += chunkSize;
+            }
+            if (filled != frame.values.size())
+                Fail();
+
+            return true;
+        }
+    };
+}
+
+#endif // BINARYDUMP_H
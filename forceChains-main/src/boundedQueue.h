@@ -0,0 +1,87 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace ForceChain
+{
+    // A thread safe FIFO queue that holds at most capacity items.
+    // Push waits while it is full and Pop waits while it is empty, so
+    // a fast producer cannot run ahead of its consumer and use up memory.
+    // After Close, Push refuses new items and Pop returns false once
+    // the queue is drained.
+    template <typename T>
+    class BoundedQueue
+    {
+        std::deque<T> items;
+        size_t capacity;
+        bool isClosed = false;
+        std::mutex mutex;
+        std::condition_variable notFull;
+        std::condition_variable notEmpty;
+
+    public:
+        BoundedQueue(size_t capacity_) : capacity(capacity_ > 0 ? capacity_ : 1) {}
+
+        // Returns false if the queue is closed, the item is dropped.
+        bool Push(T item)
+        {
+            std::unique_lock lock(mutex);
+            notFull.wait(lock, [this]
+                         { return items.size() < capacity || isClosed; });
+            if (isClosed)
+                return false;
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+            return true;
+        }
+
+        // Returns false if the queue is closed and empty.
+        bool Pop(T &item)
+        {
+            std::unique_lock lock(mutex);
+            notEmpty.wait(lock, [this]
+                          { return !items.empty() || isClosed; });
+            if (items.empty())
+                return false;
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return true;
+        }
+
+        void Close()
+        {
+            std::lock_guard lock(mutex);
+            isClosed = true;
+            notFull.notify_all();
+            notEmpty.notify_all();
+        }
+    };
+}
+
+#endif // BOUNDEDQUEUE_H
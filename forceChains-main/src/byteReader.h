@@ -0,0 +1,79 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BYTEREADER_H
+#define BYTEREADER_H
+
+#include <string_view>
+#include <cstring>
+
+namespace ForceChain
+{
+    // Reads values from binary bytes in order, e.g. a mapped file.
+    // Values are copied, so they need no alignment. A read after the
+    // end of bytes fails instead of reading past them.
+    class ByteReader
+    {
+        std::string_view bytes;
+        size_t offset = 0;
+
+    public:
+        ByteReader(std::string_view bytes_) : bytes(bytes_) {}
+
+        template <typename T>
+        bool Read(T *values, size_t count)
+        {
+            auto size = count * sizeof(T);
+            if (size > bytes.size() - offset)
+                return false;
+            std::memcpy(values, bytes.data() + offset, size);
+            offset += size;
+            return true;
+        }
+
+        template <typename T>
+        bool Read(T &value)
+        {
+            return Read(&value, 1);
+        }
+
+        bool Skip(size_t size)
+        {
+            if (size > bytes.size() - offset)
+                return false;
+            offset += size;
+            return true;
+        }
+
+        bool AtEnd() const
+        {
+            return offset >= bytes.size();
+        }
+
+        auto Offset() const
+        {
+            return offset;
+        }
+    };
+}
+
+#endif // BYTEREADER_H
@@ -20,14 +20,50 @@
 # along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifndef CHAINFINDER_H
+#define CHAINFINDER_H
+
 #include "vector"
 #include "particle.h"
+#include "contactGraph.h"
 #include <Eigen/Dense>
 #include <cmath>
+#include <utility>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <stdexcept>
 #include "vectorAngle.h"
+#include "parallelFor.h"
+#include "incrementalChains.h"
 
 namespace ForceChain
 {
+    // Counters of a chain search, see BasicChainFinder.
+    struct ChainSearchStats
+    {
+        // Most links searched at once, the depth a recursive search
+        // would have reached.
+        size_t maxDepth = 0;
+        // Links whose neighbors were searched, centers included.
+        size_t visitsCount = 0;
+        // Neighbors tested to be the next link.
+        size_t testsCount = 0;
+        // Components searched in parallel, 0 if searched serially.
+        size_t componentsCount = 0;
+    };
+
+    // Cosines of the forward and backward angle checks of every edge
+    // of a contact graph, see BasicChainFinder::SetEdgeCosines. They
+    // do not depend on alpha, so searches of many alphas on one frame
+    // may share them.
+    template <typename Scalar>
+    struct EdgeCosines
+    {
+        std::vector<Scalar> forward;
+        std::vector<Scalar> backward;
+    };
+
     /*
     This class is the core of ForceChain program. 
     It finds particles that form chains.
@@ -35,87 +71,342 @@ namespace ForceChain
     Particle chainIds are set here. They must not 
     set anywhere else except the constructor of 
     Particle to be -1. 
+
+    The search runs on the hot array of particles, see
+    BasicParticleHot, and walks the contacts of graph, see
+    ContactGraph. Flips of minorDir are kept in dirSign and applied
+    when the search ends, so particles read as before. Linkages and
+    linkNodes are kept in links, see ChainLinks.
+
+    Whether a neighbor passes the angle checks to be the next link
+    does not change during the search, flipping minorDir of a link
+    or of the neighbor gives the same answer, so it is found for every
+    edge of graph before, in parallel, see SetEdgeFlags. The search is
+    then a walk over the eligible edges.
+
+    A search never leaves the particles joined to its center by
+    eligible edges, so with more than one thread these components are
+    searched in parallel, each from its centers in ascending order as
+    the serial search does. Chains are then ordered by their centers,
+    so chains, chainIds and links are the same for any threadsCount.
     */
-    class ChainFinder
+    template <typename Scalar>
+    class BasicChainFinder
     {
+        using Particle = BasicParticle<Scalar>;
+        using Hot = BasicParticleHot<Scalar>;
 
-        std::vector<Particle> &particles;
+        BasicParticles<Scalar> &particles;
+        const ContactGraph &graph;
         double alpha; // chain max angle in radian
         std::vector<std::vector<double>> box_dimension;
+        size_t threadsCount;
+
+        // Flags of the edges of graph, from a link to its neighbor.
+        enum EdgeFlag : uint8_t
+        {
+            // The neighbor has minor stress and passes the forward and
+            // backward angle checks.
+            isEligibleEdge = 1,
+            // The neighbor's minorDir is flipped to pass the backward
+            // check, neiDirSign is -1.
+            isFlippedEdge = 2
+        };
+        std::vector<uint8_t> edgeFlags;
+
+        // A link whose neighbors are being searched, and the edge of
+        // graph to its next neighbor.
+        struct Visit
+        {
+            size_t ilink;
+            size_t edge;
+        };
 
+        // What a thread finds, apart from particles and links.isLinked of
+        // the components it searches.
+        struct Search
+        {
+            // Links being searched, from the chain center to the last
+            // one found. It is reused by every search.
+            std::vector<Visit> visits;
+
+            // (particle, id of the particle it was linked from) of
+            // every link, in the order found. links.linkNodes is made
+            // of it.
+            std::vector<std::pair<size_t, int64_t>> inwardLinks;
+
+            // Chains kept, in the order of their centers. chainIds of
+            // particles are indices of it until the searches are merged.
+            std::vector<std::vector<size_t>> chains;
+
+            ChainSearchStats stats;
+        };
 
     public:
-        // Stores the chains.
+        // Stores the chains, as indices of their particles.
         std::vector<std::vector<size_t>> chains;
 
-        ChainFinder(std::vector<Particle> &particles_, double alpha_, std::vector<std::vector<double>> box_dimension_)
-            : particles(particles_), alpha(alpha_), box_dimension(box_dimension_) {}
+        // Linkages and linkNodes of the particles.
+        ChainLinks links;
+
+        // Counters of the last RecursiveFindChains.
+        ChainSearchStats stats;
+
+        // If set, edges are flagged from these cosines, found by
+        // SetEdgeCosines on the same particles and graph, instead of
+        // from the particles.
+        const EdgeCosines<Scalar> *edgeCosines = nullptr;
+
+        // If set, vectors of the edges are taken from these, found by
+        // SetEdgeBranches on the same particles and graph, instead of
+        // from positions of particles.
+        const EdgeBranches<Scalar> *edgeBranches = nullptr;
+
+        // If set, only the components of particles that changed since
+        // the search kept in it are searched, and this search is kept
+        // for the next frame, see BasicIncrementalChains.
+        BasicIncrementalChains<Scalar> *incrementalChains = nullptr;
+
+        // threadsCount is used to flag the edges and to search the
+        // components, 0 uses all cores.
+        BasicChainFinder(BasicParticles<Scalar> &particles_, const ContactGraph &graph_, double alpha_,
+                         std::vector<std::vector<double>> box_dimension_, size_t threadsCount_ = 1)
+            : particles(particles_), graph(graph_), alpha(alpha_), box_dimension(box_dimension_),
+              threadsCount(threadsCount_) {}
+
+        // Finds the cosines of the angle checks of every edge, as
+        // particles are before a search.
+        void SetEdgeCosines(EdgeCosines<Scalar> &cosines) const
+        {
+            cosines.forward.resize(graph.values.size());
+            cosines.backward.resize(graph.values.size());
+            ForEachEdgeAngles([&](const Hot &link, const Hot &nei, size_t edge)
+                              {
+                auto xln = GetBranch(link, nei, edge);
+                cosines.forward[edge] = cosineBetweenVectors(xln, link.minorDir);
+                cosines.backward[edge] = cosineBetweenVectors(-xln, nei.minorDir); });
+        }
+
+        // Whether an edge of these cosines passes the angle checks,
+        // cosAlpha is cos(alpha). Its neighbor must have minor stress
+        // too to be a link.
+        static bool IsEligibleEdge(Scalar cosForward, Scalar cosBackward, Scalar cosAlpha)
+        {
+            return IsForwardEligible(cosForward, cosAlpha) && GetBackwardFlags(cosBackward, cosAlpha) != 0;
+        }
 
     protected:
-        // Studies two particles: last link of a chain and a neighbor.
-        // Decides if neighbor is the next link.
-        auto IsNeiNextLink(Particle &link, Particle &nei, int &neiDirSign)
+        // Flips minorDir of the particles the search flipped.
+        void ApplyDirSigns()
         {
+            for (auto &node : particles.hot)
+            {
+                if (node.dirSign < 0)
+                    node.minorDir = -node.minorDir;
+                node.dirSign = 1;
+            }
+        }
 
-            if (!nei.hasMinorStress)
-                return false;
+        // Rows of linkNodes, of the inward links in the order found.
+        // The links of a particle are all found by one search.
+        void SetLinkNodes(const std::vector<Search> &searches)
+        {
+            auto &linkNodes = links.linkNodes;
+            linkNodes.offsets.assign(particles.size() + 1, 0);
+            for (auto &search : searches)
+            {
+                for (auto &inwardLink : search.inwardLinks)
+                    linkNodes.offsets[inwardLink.first + 1]++;
+            }
+            for (size_t i = 0; i < particles.size(); i++)
+                linkNodes.offsets[i + 1] += linkNodes.offsets[i];
 
-            if ((nei.chainId != -1) && (nei.chainId != link.chainId))
-                return false;            
-            
-            if (nei.chainId == link.chainId){
-                for(auto id: link.linkages){
-                    if (id==nei.id)
-                        return false;
-                }
-            } 
+            linkNodes.values.resize(linkNodes.offsets.back());
+            std::vector<size_t> next(linkNodes.offsets.begin(), linkNodes.offsets.end() - 1);
+            for (auto &search : searches)
+            {
+                for (auto &inwardLink : search.inwardLinks)
+                    linkNodes.values[next[inwardLink.first]++] = inwardLink.second;
+            }
+        }
 
-            // is neighbor within link range
-            auto xln = nei.distanceTo(link);
+        // Flags every edge between particles a and b, in both rows.
+        void FlagLinkage(size_t a, size_t b)
+        {
+            for (auto edge = graph.offsets[a]; edge < graph.offsets[a + 1]; edge++)
+                links.isLinked[edge] |= graph.values[edge] == b;
+            for (auto edge = graph.offsets[b]; edge < graph.offsets[b + 1]; edge++)
+                links.isLinked[edge] |= graph.values[edge] == a;
+        }
 
-            //  Y periodic interaction
-            if (xln.norm() > (nei.radius + link.radius)){
-                auto nei_pos_adjusted= periodic_adjust(link.position, nei.position, box_dimension[0], box_dimension[1]);
-                xln = nei_pos_adjusted-link.position; 
-            }
+        // Vector of edge from a link to a neighbor, across the periodic
+        // boundary if they are apart, see EdgeBranches.
+        Eigen::Matrix<Scalar, 3, 1> GetBranch(const Hot &link, const Hot &nei, size_t edge) const
+        {
+            if (edgeBranches)
+                return (*edgeBranches)[edge];
+            return GetContactImage(link.position, nei.position, nei.radius + link.radius,
+                                   box_dimension[0], box_dimension[1]) - link.position;
+        }
 
-            auto angle_forward = angleBetweenVectors(xln, link.minorDir);
+        // The angle checks compare cosines of the angles with
+        // cos(alpha), with the same bounds as the angles.
 
-            // forward check
-            if ((angle_forward >= alpha) && (angle_forward< M_PI-alpha))
-            {
-                return false;
-            }
+        // forward check, fails if the angle is in [alpha, pi-alpha)
+        static bool IsForwardEligible(Scalar cosForward, Scalar cosAlpha)
+        {
+            return !(cosForward <= cosAlpha && cosForward > -cosAlpha);
+        }
 
-            // backward check
+        // backward check, fails if the angle, or pi minus it if above
+        // pi/2, is alpha or more. Gives edgeFlags of the edge if the
+        // forward check passed.
+        static uint8_t GetBackwardFlags(Scalar cosBack, Scalar cosAlpha)
+        {
+            if (cosBack <= cosAlpha && cosBack >= -cosAlpha)
+                return 0;
 
-            auto angle_back = angleBetweenVectors(-xln, nei.minorDir);
-            neiDirSign = +1;
             // Change direction if angle>pi/2, and record it.
-            if (angle_back > M_PI / 2)
+            return cosBack < 0 ? isEligibleEdge | isFlippedEdge : isEligibleEdge;
+        }
+
+        // Threads that share the rows of graph.
+        size_t GetEdgeThreadsCount() const
+        {
+            auto count = threadsCount == 0 ? DefaultThreadsCount() : threadsCount;
+            return std::max<size_t>(1, std::min(count, graph.values.size() / 65536 + 1));
+        }
+
+        // Calls work(link, nei, edge) for all the edges of graph, with
+        // the hot fields of their particles, rows are shared by
+        // threads. If rows is set, only for rows i that rows[i] is set,
+        // serially, as they are expected to be few.
+        template <typename Work>
+        void ForEachEdgeAngles(Work work, const std::vector<uint8_t> *rows = nullptr) const
+        {
+            if (edgeBranches && edgeBranches->size() != graph.values.size())
+                throw std::runtime_error("\n Error: edge branches are not of the contact graph.\n");
+
+            auto particlesCount = particles.size();
+            auto &nodes = particles.hot;
+            if (rows)
             {
-                angle_back = M_PI - angle_back;
-                neiDirSign = -1;
+                for (size_t ilink = 0; ilink < particlesCount; ilink++)
+                {
+                    if (!(*rows)[ilink])
+                        continue;
+                    for (auto edge = graph.offsets[ilink]; edge < graph.offsets[ilink + 1]; edge++)
+                        work(nodes[ilink], nodes[graph.values[edge]], edge);
+                }
+                return;
             }
 
-            //backward check
-            if (angle_back >= alpha)
+            auto count = GetEdgeThreadsCount();
+            ParallelFor(count, [&](size_t iThread)
+                        {
+                auto first = particlesCount * iThread / count;
+                auto last = particlesCount * (iThread + 1) / count;
+                for (auto ilink = first; ilink < last; ilink++)
+                {
+                    auto &link = nodes[ilink];
+                    for (auto edge = graph.offsets[ilink]; edge < graph.offsets[ilink + 1]; edge++)
+                        work(link, particles.hot[graph.values[edge]], edge);
+                } });
+        }
+
+        // Flags all the edges of graph, from edgeCosines if set. If
+        // rows is set, only the rows i that rows[i] is set are flagged
+        // from the particles.
+        void SetEdgeFlags(const std::vector<uint8_t> *rows = nullptr)
+        {
+            auto cosAlpha = Scalar(std::cos(alpha));
+            edgeFlags.resize(graph.values.size());
+            if (!edgeCosines)
             {
-                return false;
+                ForEachEdgeAngles([&](const Hot &link, const Hot &nei, size_t edge)
+                                  {
+                    edgeFlags[edge] = 0;
+                    if (!nei.hasMinorStress)
+                        return;
+                    auto xln = GetBranch(link, nei, edge);
+                    if (IsForwardEligible(cosineBetweenVectors(xln, link.minorDir), cosAlpha))
+                        edgeFlags[edge] = GetBackwardFlags(cosineBetweenVectors(-xln, nei.minorDir), cosAlpha); }, rows);
+                return;
             }
 
+            if (edgeCosines->forward.size() != graph.values.size())
+                throw std::runtime_error("\n Error: edge cosines are not of the contact graph.\n");
+
+            auto edgesCount = graph.values.size();
+            auto count = GetEdgeThreadsCount();
+            ParallelFor(count, [&](size_t iThread)
+                        {
+                auto first = edgesCount * iThread / count;
+                auto last = edgesCount * (iThread + 1) / count;
+                for (auto edge = first; edge < last; edge++)
+                {
+                    bool isEligible = particles.hot[graph.values[edge]].hasMinorStress &&
+                                      IsForwardEligible(edgeCosines->forward[edge], cosAlpha);
+                    edgeFlags[edge] = isEligible ? GetBackwardFlags(edgeCosines->backward[edge], cosAlpha) : 0;
+                } });
+        }
+
+        // Studies two particles: last link of a chain and a neighbor.
+        // Decides if neighbor is the next link. edge is the one from
+        // link to neighbor in graph. neiDirSign is the sign of the
+        // neighbor's minorDir, of the particle, that passed the
+        // backward check.
+        auto IsNeiNextLink(size_t ilink, size_t inei, size_t edge, int &neiDirSign)
+        {
+            auto flags = edgeFlags[edge];
+            if (!(flags & isEligibleEdge))
+                return false;
+
+            auto &link = particles.hot[ilink];
+            auto &nei = particles.hot[inei];
+
+            if ((nei.chainId != -1) && (nei.chainId != link.chainId))
+                return false;            
+            
+            if (nei.chainId == link.chainId && links.isLinked[edge])
+                return false;
+
+            neiDirSign = (flags & isFlippedEdge) ? -1 : +1;
+
             // Passed all the conditions:
             return true;
         }
 
-        // Finds next link of chain recursively. It accounts for
-        // a link branches multiple times.
-        void RecursiveFindOneSideOfChain(std::vector<size_t> &chain, Particle *link)
+        // Finds next links of chain from icenter, depth first. It
+        // accounts for a link branches multiple times.
+        // It is the recursion over neighbors of links on the explicit
+        // stack visits: a new link is searched right away and its
+        // parent goes on from the next edge once it is done, so the
+        // links are found in the same order, however long the chain.
+        void FindOneSideOfChain(Search &search, std::vector<size_t> &chain, size_t icenter)
         {
-            for (auto inei : link->neighbors)
+            auto &visits = search.visits;
+            auto &stats = search.stats;
+            visits.clear();
+            visits.push_back({icenter, graph.offsets[icenter]});
+            stats.visitsCount++;
+            stats.maxDepth = std::max<size_t>(stats.maxDepth, 1);
+
+            while (!visits.empty())
             {
+                auto &visit = visits.back();
+                if (visit.edge == graph.offsets[visit.ilink + 1])
+                {
+                    visits.pop_back();
+                    continue;
+                }
+
+                auto ilink = visit.ilink;
+                auto edge = visit.edge++;
+                stats.testsCount++;
+
                 // is neighbor next link
-                auto &nei = particles[inei];
+                size_t inei = graph.values[edge];
 
                 // To store which direction used for nei
                 // to be next link. The opposite dir will
@@ -123,78 +414,410 @@ namespace ForceChain
                 // searching in its neighbors.
                 int neiDirSign;
 
-                if (!IsNeiNextLink(*link, nei, neiDirSign))
+                if (!IsNeiNextLink(ilink, inei, edge, neiDirSign))
                     continue;
 
                 // backward & forward check staisfied
                 // nei is next link of the chain
                 chain.push_back(inei);
-                link->linkages.push_back(inei);
+                FlagLinkage(ilink, inei);
 
-                nei.chainId = link->chainId;
-                nei.linkNodes.push_back(link->id);
-                nei.linkages.push_back(link->id);
-                
+                particles.hot[inei].chainId = particles.hot[ilink].chainId;
+                search.inwardLinks.push_back({inei, int64_t(particles[ilink].id)});
 
                 // reverse the used dir for next loop
-                nei.minorDir = -neiDirSign * nei.minorDir;
+                particles.hot[inei].dirSign = -neiDirSign;
 
-                RecursiveFindOneSideOfChain(chain, &nei);
+                visits.push_back({inei, graph.offsets[inei]});
+                stats.visitsCount++;
+                stats.maxDepth = std::max(stats.maxDepth, visits.size());
             }
         }
 
-    public:
-        // Finds all the chains in the system.
-        auto &RecursiveFindChains()
+        // Searches the chain of icenter, if it is not in one yet.
+        void FindChainFrom(Search &search, size_t icenter)
         {
-            // Each particle is center of a chain
-            for (auto &center : particles)
+            auto &center = particles.hot[icenter];
+
+            // When checking a particle all their neighbors
+            // are checked too. So, if a neighbor being studied
+            // and belongs to a chain, now we ignore it.
+            if (!center.hasMinorStress || center.chainId>=0)
+                return;
+
+            std::vector<size_t> chain;
+            chain.push_back(icenter);
+
+            // We give it next chain id, if this center forms 
+            // a chain, it will hold it, otherwise it will be
+            // cleared later on.
+            center.chainId = search.chains.size();
+
+            FindOneSideOfChain(search, chain, icenter);
+
+            // Trying the other side of center
+            center.dirSign = -center.dirSign;
+
+            FindOneSideOfChain(search, chain, icenter);
+
+            // Both side of the chain completed.
+            // clear chain if has less than 3 particles
+            if (chain.size() < 3)
             {
-                // When checking a particle all their neighbors
-                // are checked too. So, if a neighbor being studied
-                // and belongs to a chain, now we ignore it.
-                if (!center.hasMinorStress || center.chainId>=0)
+                for (auto &particleId : chain)
+                {
+                    particles.hot[particleId].chainId = -1;
+                }
+                
+                // Negating the last "linkNodes" entry of the second particle of the chain,
+                // it is the only link of this chain, so the last one found.
+                if (chain.size()==2)
+                {
+                    search.inwardLinks.back().second = -1*search.inwardLinks.back().second;
+                }
+            }
+            else
+            { // record bigger chains
+
+                search.chains.push_back(chain);
+            }
+        }
+
+        // Rows of components of the particles with minor stress, joined
+        // by eligible edges in either direction. A component lists its
+        // particles in ascending order, components are in the order of
+        // their first particles.
+        void SetComponents(CsrRows<uint32_t> &components) const
+        {
+            auto particlesCount = particles.size();
+
+            // Union find, the root of a set is its first particle.
+            std::vector<uint32_t> parents(particlesCount);
+            std::iota(parents.begin(), parents.end(), 0);
+            auto findRoot = [&](uint32_t i)
+            {
+                while (parents[i] != i)
+                {
+                    parents[i] = parents[parents[i]];
+                    i = parents[i];
+                }
+                return i;
+            };
+            for (size_t ilink = 0; ilink < particlesCount; ilink++)
+            {
+                if (!particles.hot[ilink].hasMinorStress)
                     continue;
+                for (auto edge = graph.offsets[ilink]; edge < graph.offsets[ilink + 1]; edge++)
+                {
+                    if (!(edgeFlags[edge] & isEligibleEdge))
+                        continue;
+                    auto a = findRoot(ilink), b = findRoot(graph.values[edge]);
+                    if (a != b)
+                        parents[std::max(a, b)] = std::min(a, b);
+                }
+            }
+
+            // Component of each particle, roots come before the rest of
+            // their sets.
+            std::vector<uint32_t> componentIds(particlesCount);
+            components.offsets.assign(1, 0);
+            for (size_t i = 0; i < particlesCount; i++)
+            {
+                if (!particles.hot[i].hasMinorStress)
+                    continue;
+                auto root = findRoot(i);
+                if (root == i)
+                {
+                    componentIds[i] = components.RowsCount();
+                    components.offsets.push_back(0);
+                }
+                else
+                    componentIds[i] = componentIds[root];
+                components.offsets[componentIds[i] + 1]++;
+            }
+            std::partial_sum(components.offsets.begin(), components.offsets.end(), components.offsets.begin());
+
+            components.values.resize(components.offsets.back());
+            std::vector<size_t> next(components.offsets.begin(), components.offsets.end() - 1);
+            for (size_t i = 0; i < particlesCount; i++)
+            {
+                if (particles.hot[i].hasMinorStress)
+                    components.values[next[componentIds[i]]++] = i;
+            }
+        }
+
+        // Searches all the components by count threads.
+        void FindChainsOfComponents(std::vector<Search> &searches, size_t count)
+        {
+            CsrRows<uint32_t> components;
+            SetComponents(components);
+
+            std::vector<uint32_t> order(components.RowsCount());
+            std::iota(order.begin(), order.end(), 0);
+            SearchComponents(searches, count, components, order);
+            searches[0].stats.componentsCount = components.RowsCount();
+        }
+
+        // Searches the components of order by count threads, each takes
+        // the next one not taken yet, the largest ones first.
+        void SearchComponents(std::vector<Search> &searches, size_t count, const CsrRows<uint32_t> &components,
+                              std::vector<uint32_t> &order)
+        {
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                      { return components.GetRow(a).size() > components.GetRow(b).size(); });
+
+            std::atomic<size_t> nextComponent{0};
+            searches.resize(count);
+            ParallelFor(count, [&](size_t iThread)
+                        {
+                auto &search = searches[iThread];
+                for (auto k = nextComponent++; k < order.size(); k = nextComponent++)
+                {
+                    for (auto icenter : components.GetRow(order[k]))
+                        FindChainFrom(search, icenter);
+                } });
+        }
+
+        // Gathers chains of searches in the order of their centers,
+        // the order of the serial search, and gives their particles
+        // the index of their chain.
+        void MergeSearches(std::vector<Search> &searches)
+        {
+            chains.clear();
+            stats = {};
+            for (auto &search : searches)
+            {
+                for (auto &chain : search.chains)
+                    chains.push_back(std::move(chain));
+                search.chains.clear();
+                stats.maxDepth = std::max(stats.maxDepth, search.stats.maxDepth);
+                stats.visitsCount += search.stats.visitsCount;
+                stats.testsCount += search.stats.testsCount;
+                stats.componentsCount += search.stats.componentsCount;
+            }
+
+            std::sort(chains.begin(), chains.end(), [](const std::vector<size_t> &a, const std::vector<size_t> &b)
+                      { return a.front() < b.front(); });
+            for (size_t chainId = 0; chainId < chains.size(); chainId++)
+            {
+                for (auto i : chains[chainId])
+                    particles.hot[i].chainId = chainId;
+            }
+        }
 
-                std::vector<size_t> chain;
-                chain.push_back(center.id);
+        // Whether the search kept in incrementalChains is of the same
+        // particles, alpha and box. isFresh is whether no particle is in
+        // a chain yet.
+        bool CanReuseKeptSearch(bool isFresh) const
+        {
+            auto &kept = *incrementalChains;
+            if (!kept.hasFrame || !isFresh || edgeCosines || kept.alpha != alpha ||
+                kept.box != box_dimension || kept.ids.size() != particles.size())
+                return false;
+            for (size_t i = 0; i < particles.size(); i++)
+            {
+                if (kept.ids[i] != particles[i].id)
+                    return false;
+            }
+            return true;
+        }
 
-                // We give it next chain id, if this center forms 
-                // a chain, it will hold it, otherwise it will be
-                // cleared later on.
-                center.chainId = chains.size();
+        // Whether particle i changed since the kept search, see
+        // BasicIncrementalChains.
+        bool IsChangedParticle(size_t i) const
+        {
+            auto &kept = *incrementalChains;
+            auto particle = particles[i];
+            if (particle.hasMinorStress != bool(kept.hasMinorStress[i]) || particle.radius != kept.radii[i] ||
+                particle.position != kept.positions[i] || particle.minorDir != kept.minorDirs[i])
+                return true;
+
+            auto row = graph.GetRow(i);
+            auto keptRow = kept.graph.GetRow(i);
+            return row.size() != keptRow.size() || !std::equal(row.begin(), row.end(), keptRow.begin());
+        }
 
-                RecursiveFindOneSideOfChain(chain, &center);
+        // Searches only the components that hold a particle changed
+        // since the kept search, or touching one. The others take the
+        // edge flags, chains, dirSigns and links of the kept search.
+        // isChanged is set for the particles that changed.
+        void FindChangedChains(std::vector<Search> &searches, size_t count, std::vector<uint8_t> &isChanged)
+        {
+            auto &kept = *incrementalChains;
+            auto particlesCount = particles.size();
 
-                // Trying the other side of center
-                center.minorDir = -center.minorDir;
+            isChanged.resize(particlesCount);
+            for (size_t i = 0; i < particlesCount; i++)
+                isChanged[i] = IsChangedParticle(i);
 
-                RecursiveFindOneSideOfChain(chain, &center);
+            // Rows whose edges may have other flags.
+            std::vector<uint8_t> isDirty(isChanged);
+            for (size_t i = 0; i < particlesCount; i++)
+            {
+                for (auto inei : graph.GetRow(i))
+                    isDirty[i] |= isChanged[inei];
+            }
 
-                // Both side of the chain completed.
-                // clear chain if has less than 3 particles
-                if (chain.size() < 3)
+            SetEdgeFlags(&isDirty);
+            for (size_t i = 0; i < particlesCount; i++)
+            {
+                if (!isDirty[i])
+                    std::copy(kept.edgeFlags.begin() + kept.graph.offsets[i], kept.edgeFlags.begin() + kept.graph.offsets[i + 1],
+                              edgeFlags.begin() + graph.offsets[i]);
+            }
+            links.isLinked.assign(graph.values.size(), 0);
+
+            CsrRows<uint32_t> components;
+            SetComponents(components);
+
+            Search copied;
+            std::vector<uint32_t> order;
+            kept.searchedCount = 0;
+            for (uint32_t k = 0; k < components.RowsCount(); k++)
+            {
+                auto component = components.GetRow(k);
+                if (std::any_of(component.begin(), component.end(), [&](uint32_t i)
+                                { return isDirty[i]; }))
                 {
-                    for (auto &particleId : chain)
-                    {
-                        particles[particleId].chainId = -1;
-                    }
-                    
-                    // Setting the last "linkNodes" entry of the second particle of the chain to 0
-                    if (chain.size()==2)
-                    {
-                        auto last_node_index = particles[chain[1]].linkNodes.size()-1;
-                        particles[chain[1]].linkNodes[last_node_index] = -1*particles[chain[1]].linkNodes[last_node_index];
-                    }
+                    order.push_back(k);
+                    kept.searchedCount += component.size();
+                    continue;
                 }
-                else
-                { // record bigger chains
 
-                    chains.push_back(chain);
+                for (auto i : component)
+                {
+                    auto chainId = kept.chainIds[i];
+                    particles.hot[i].chainId = chainId;
+                    particles.hot[i].dirSign = kept.dirSigns[i];
+                    std::copy(kept.links.isLinked.begin() + kept.graph.offsets[i],
+                              kept.links.isLinked.begin() + kept.graph.offsets[i + 1],
+                              links.isLinked.begin() + graph.offsets[i]);
+                    for (auto linkNode : kept.links.linkNodes.GetRow(i))
+                        copied.inwardLinks.push_back({i, linkNode});
+                    if (chainId >= 0 && kept.chains[chainId].front() == i)
+                        copied.chains.push_back(kept.chains[chainId]);
                 }
             }
 
+            SearchComponents(searches, count, components, order);
+            if (count > 1)
+                searches[0].stats.componentsCount = order.size();
+            searches.push_back(std::move(copied));
+        }
+
+        // Keeps this search in incrementalChains for the next frame.
+        // Call it before minorDir of particles are flipped. If
+        // isChanged is set, it is of the kept search, and only the
+        // particles that changed are kept again.
+        void KeepSearch(bool isFresh, const std::vector<uint8_t> *isChanged)
+        {
+            auto &kept = *incrementalChains;
+            auto particlesCount = particles.size();
+
+            // A search of particles in chains is not of their frame.
+            kept.hasFrame = isFresh;
+            kept.alpha = alpha;
+            kept.box = box_dimension;
+            kept.ids.resize(particlesCount);
+            kept.positions.resize(particlesCount);
+            kept.minorDirs.resize(particlesCount);
+            kept.radii.resize(particlesCount);
+            kept.hasMinorStress.resize(particlesCount);
+            kept.chainIds.resize(particlesCount);
+            kept.dirSigns.resize(particlesCount);
+            for (size_t i = 0; i < particlesCount; i++)
+            {
+                kept.chainIds[i] = particles.hot[i].chainId;
+                kept.dirSigns[i] = particles.hot[i].dirSign;
+                if (isChanged && !(*isChanged)[i])
+                    continue;
+
+                auto particle = particles[i];
+                kept.ids[i] = particle.id;
+                kept.positions[i] = particle.position;
+                kept.minorDirs[i] = particle.minorDir;
+                kept.radii[i] = particle.radius;
+                kept.hasMinorStress[i] = particle.hasMinorStress;
+            }
+            // Rows of unchanged particles are the same.
+            if (!isChanged || kept.graph.values.size() != graph.values.size() ||
+                std::any_of(isChanged->begin(), isChanged->end(), [](uint8_t is)
+                            { return is; }))
+                kept.graph = graph;
+            kept.edgeFlags.swap(edgeFlags);
+            kept.chains = chains;
+            kept.links = links;
+        }
+
+        // Throws if a full search of fullParticles, the particles
+        // before this search, finds other than this one.
+        void CheckIncrementalChains(BasicParticles<Scalar> &fullParticles) const
+        {
+            BasicChainFinder fullFinder(fullParticles, graph, alpha, box_dimension, threadsCount);
+            fullFinder.edgeCosines = edgeCosines;
+            fullFinder.edgeBranches = edgeBranches;
+            fullFinder.RecursiveFindChains();
+
+            bool isSame = fullFinder.chains == chains && fullFinder.links.isLinked == links.isLinked &&
+                          fullFinder.links.linkNodes.offsets == links.linkNodes.offsets &&
+                          fullFinder.links.linkNodes.values == links.linkNodes.values;
+            for (size_t i = 0; isSame && i < particles.size(); i++)
+                isSame = fullParticles[i].chainId == particles[i].chainId &&
+                         fullParticles[i].minorDir == particles[i].minorDir;
+            if (!isSame)
+                throw std::runtime_error("\n Error: incremental chains differ from the ones of a full search.\n");
+        }
+
+    public:
+        // Finds all the chains in the system.
+        auto &RecursiveFindChains()
+        {
+            bool isChecked = incrementalChains && incrementalChains->isChecked;
+            BasicParticles<Scalar> fullParticles;
+            if (isChecked)
+                fullParticles = particles;
+
+            auto isFresh = std::all_of(particles.hot.begin(), particles.hot.end(), [](const Hot &node)
+                                       { return node.chainId == -1; });
+
+            auto count = threadsCount == 0 ? DefaultThreadsCount() : threadsCount;
+            std::vector<Search> searches(1);
+            std::vector<uint8_t> isChanged;
+            bool isReused = incrementalChains && CanReuseKeptSearch(isFresh);
+            if (isReused)
+                FindChangedChains(searches, count, isChanged);
+            else
+            {
+                SetEdgeFlags();
+                links.isLinked.assign(graph.values.size(), 0);
+                if (count > 1)
+                    FindChainsOfComponents(searches, count);
+                else
+                {
+                    // Each particle is center of a chain
+                    for (size_t icenter = 0; icenter < particles.size(); icenter++)
+                        FindChainFrom(searches[0], icenter);
+                }
+                if (incrementalChains)
+                    incrementalChains->searchedCount = std::count_if(particles.hot.begin(), particles.hot.end(), [](const Hot &node)
+                                                                     { return node.hasMinorStress; });
+            }
+            MergeSearches(searches);
+            SetLinkNodes(searches);
+            if (incrementalChains)
+                KeepSearch(isFresh, isReused ? &isChanged : nullptr);
+
+            ApplyDirSigns();
+            edgeFlags.clear();
+            edgeFlags.shrink_to_fit();
+
+            if (isChecked)
+                CheckIncrementalChains(fullParticles);
             return chains;
         }
     };
+
+    using ChainFinder = BasicChainFinder<double>;
 }
+
+#endif // CHAINFINDER_H
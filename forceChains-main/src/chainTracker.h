@@ -0,0 +1,370 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CHAINTRACKER_H
+#define CHAINTRACKER_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include "particle.h"
+#include "particleIdMap.h"
+
+namespace ForceChain
+{
+    enum class ChainEventType
+    {
+        Birth,
+        Death,
+        Split,
+        Merge
+    };
+
+    // What happened to chains from the frame before timestep to it.
+    struct ChainEvent
+    {
+        ChainEventType type;
+        size_t timestep;
+        // Tracks before and after the event. A birth has
+        // no fromTracks and a death has no toTracks.
+        std::vector<size_t> fromTracks;
+        std::vector<size_t> toTracks;
+    };
+
+    // One chain followed over consecutive frames.
+    struct ChainTrack
+    {
+        size_t firstTimestep = 0;
+        size_t lastTimestep = 0;
+        size_t framesCount = 0;
+        size_t maxLength = 0;
+        // False once the chain is gone, split or merged into
+        // another track.
+        bool isAlive = true;
+
+        auto GetLifetime() const
+        {
+            return lastTimestep - firstTimestep;
+        }
+    };
+
+    /*
+    Follows chains from frame to frame by the LIGGGHTS ids of their
+    particles, so chains of any finder and any particle order can be
+    given, e.g. those of UserInterface or TiledChainFinder.
+
+    A chain of the previous frame and one of the new frame overlap if
+    the particles they share are at least minOverlap of the shorter
+    one. Shared particles are counted through an index from ids of the
+    previous chain particles to their chain, so a frame costs about
+    the particles in chains, whatever the number of frames or chains.
+
+    A new chain carries on the track of the previous chain it overlaps
+    most if that previous chain overlaps it most too, other chains
+    start new tracks. Events of a frame are:
+     - Birth, a new chain overlaps no previous chain,
+     - Death, a previous chain overlaps no new chain,
+     - Split, a previous chain overlaps many new chains,
+     - Merge, a new chain overlaps many previous chains.
+    Chains of the first frame are births.
+    */
+    class ChainTracker
+    {
+        static constexpr size_t none = SIZE_MAX;
+
+        // Overlap of a previous and a new chain.
+        struct Overlap
+        {
+            size_t previous;
+            size_t current;
+            size_t count;
+        };
+
+        bool hasFrame = false;
+
+        // Maps ids of particles of the previous chains to the
+        // index of their chain in previousChains.
+        ParticleIdMap idMap;
+        std::vector<size_t> previousChains;
+        std::vector<size_t> previousLengths;
+
+        // Shared particles of a new chain with each previous one,
+        // and the previous chains it shares any with.
+        std::vector<size_t> counts;
+        std::vector<size_t> touched;
+
+        // Overlaps of the new chains with the previous ones, in
+        // the order of new chains.
+        auto GetOverlaps(const std::vector<size_t> &ids, const std::vector<std::vector<size_t>> &chains)
+        {
+            std::vector<Overlap> overlaps;
+            if (!hasFrame)
+                return overlaps;
+
+            counts.assign(previousLengths.size(), 0);
+            size_t iId = 0;
+            for (size_t current = 0; current < chains.size(); current++)
+            {
+                for (size_t i = 0; i < chains[current].size(); i++)
+                {
+                    auto index = idMap.Find(ids[iId++]);
+                    if (index == ParticleIdMap::missing)
+                        continue;
+                    auto previous = previousChains[index];
+                    if (counts[previous]++ == 0)
+                        touched.push_back(previous);
+                }
+
+                std::sort(touched.begin(), touched.end());
+                for (auto previous : touched)
+                {
+                    auto shorter = std::min(previousLengths[previous], chains[current].size());
+                    if (counts[previous] >= minOverlap * shorter)
+                        overlaps.push_back({previous, current, counts[previous]});
+                    counts[previous] = 0;
+                }
+                touched.clear();
+            }
+            return overlaps;
+        }
+
+        auto StartTrack(size_t timestep)
+        {
+            ChainTrack track;
+            track.firstTimestep = timestep;
+            tracks.push_back(track);
+            return tracks.size() - 1;
+        }
+
+    public:
+        // Least share of the shorter chain two chains of
+        // consecutive frames must share to overlap.
+        double minOverlap;
+
+        std::vector<ChainTrack> tracks;
+        std::vector<ChainEvent> events;
+
+        // Track of each chain of the last frame.
+        std::vector<size_t> chainTracks;
+
+        ChainTracker(double minOverlap_ = 0.5) : minOverlap(minOverlap_) {}
+
+        // Forgets all frames, tracks and events.
+        void Reset()
+        {
+            hasFrame = false;
+            idMap = ParticleIdMap();
+            previousChains.clear();
+            previousLengths.clear();
+            tracks.clear();
+            events.clear();
+            chainTracks.clear();
+        }
+
+        // Matches chains of a frame, whose items are indices of
+        // particles, with those of the frame added before. Frames
+        // must be added in order of their timesteps.
+        template <typename Scalar>
+        void AddFrame(const BasicParticles<Scalar> &particles,
+                      const std::vector<std::vector<size_t>> &chains, size_t timestep)
+        {
+            AddFrameOf([&](size_t i)
+                       { return particles[i].id; }, chains, timestep);
+        }
+
+        // The same for chains whose items are indices of particleIds,
+        // the LIGGGHTS ids, see BasicTiledChainFinder.
+        void AddFrame(const std::vector<size_t> &particleIds,
+                      const std::vector<std::vector<size_t>> &chains, size_t timestep)
+        {
+            AddFrameOf([&](size_t i)
+                       { return particleIds[i]; }, chains, timestep);
+        }
+
+    private:
+        // AddFrame, idOf(i) is the LIGGGHTS id of particle i.
+        template <typename IdOf>
+        void AddFrameOf(IdOf idOf, const std::vector<std::vector<size_t>> &chains, size_t timestep)
+        {
+            std::vector<size_t> ids, lengths(chains.size()), particleChains;
+            for (size_t current = 0; current < chains.size(); current++)
+            {
+                lengths[current] = chains[current].size();
+                for (auto particleId : chains[current])
+                {
+                    ids.push_back(idOf(particleId));
+                    particleChains.push_back(current);
+                }
+            }
+
+            auto overlaps = GetOverlaps(ids, chains);
+
+            // The largest overlap of each chain, ties go to the
+            // lower chain index.
+            auto previousCount = previousLengths.size();
+            std::vector<size_t> bestOfPrevious(previousCount, none), bestOfCurrent(chains.size(), none);
+            std::vector<size_t> overlapsOfPrevious(previousCount, 0), overlapsOfCurrent(chains.size(), 0);
+            for (size_t i = 0; i < overlaps.size(); i++)
+            {
+                auto &overlap = overlaps[i];
+                auto &ofPrevious = bestOfPrevious[overlap.previous];
+                auto &ofCurrent = bestOfCurrent[overlap.current];
+                if (ofPrevious == none || overlaps[ofPrevious].count < overlap.count)
+                    ofPrevious = i;
+                if (ofCurrent == none || overlaps[ofCurrent].count < overlap.count)
+                    ofCurrent = i;
+                overlapsOfPrevious[overlap.previous]++;
+                overlapsOfCurrent[overlap.current]++;
+            }
+
+            std::vector<size_t> newChainTracks(chains.size());
+            std::vector<bool> isCarried(previousCount, false);
+            for (size_t current = 0; current < chains.size(); current++)
+            {
+                auto best = bestOfCurrent[current];
+                if (best != none && bestOfPrevious[overlaps[best].previous] == best)
+                {
+                    newChainTracks[current] = chainTracks[overlaps[best].previous];
+                    isCarried[overlaps[best].previous] = true;
+                }
+                else
+                    newChainTracks[current] = StartTrack(timestep);
+
+                auto &track = tracks[newChainTracks[current]];
+                track.lastTimestep = timestep;
+                track.framesCount++;
+                track.maxLength = std::max(track.maxLength, lengths[current]);
+            }
+
+            // Overlaps in the order of previous chains.
+            std::vector<size_t> byPrevious(overlaps.size());
+            std::iota(byPrevious.begin(), byPrevious.end(), 0);
+            std::stable_sort(byPrevious.begin(), byPrevious.end(), [&](size_t a, size_t b)
+                             { return overlaps[a].previous < overlaps[b].previous; });
+
+            size_t iOverlap = 0;
+            for (size_t previous = 0; previous < previousCount; previous++)
+            {
+                auto track = chainTracks[previous];
+                if (!isCarried[previous])
+                    tracks[track].isAlive = false;
+
+                if (overlapsOfPrevious[previous] == 0)
+                    events.push_back({ChainEventType::Death, timestep, {track}, {}});
+                if (overlapsOfPrevious[previous] > 1)
+                {
+                    ChainEvent split{ChainEventType::Split, timestep, {track}, {}};
+                    for (size_t i = 0; i < overlapsOfPrevious[previous]; i++)
+                        split.toTracks.push_back(newChainTracks[overlaps[byPrevious[iOverlap + i]].current]);
+                    events.push_back(split);
+                }
+                iOverlap += overlapsOfPrevious[previous];
+            }
+
+            iOverlap = 0;
+            for (size_t current = 0; current < chains.size(); current++)
+            {
+                auto track = newChainTracks[current];
+                if (overlapsOfCurrent[current] == 0)
+                    events.push_back({ChainEventType::Birth, timestep, {}, {track}});
+                if (overlapsOfCurrent[current] > 1)
+                {
+                    ChainEvent merge{ChainEventType::Merge, timestep, {}, {track}};
+                    for (size_t i = 0; i < overlapsOfCurrent[current]; i++)
+                        merge.fromTracks.push_back(chainTracks[overlaps[iOverlap + i].previous]);
+                    events.push_back(merge);
+                }
+                iOverlap += overlapsOfCurrent[current];
+            }
+
+            idMap = ParticleIdMap(ids);
+            previousChains = std::move(particleChains);
+            previousLengths = std::move(lengths);
+            chainTracks = std::move(newChainTracks);
+            hasFrame = true;
+        }
+
+    public:
+        // Number of events of type.
+        auto CountEvents(ChainEventType type) const
+        {
+            return std::count_if(events.begin(), events.end(), [&](const ChainEvent &event)
+                                 { return event.type == type; });
+        }
+
+        // Writes a row for each track, its lifetime is in timesteps.
+        auto WriteTracksCsv(std::string fileName, bool withHeaders, std::string delimiter) const
+        {
+            std::ofstream fileStream(fileName);
+            if (!fileStream)
+                throw std::runtime_error("\n Error: Cannot write the below file:\n" + fileName);
+
+            if (withHeaders)
+                fileStream << "trackId" << delimiter << "firstTimestep" << delimiter << "lastTimestep" << delimiter
+                           << "lifetime" << delimiter << "framesCount" << delimiter << "maxLength" << delimiter
+                           << "isAlive" << "\n";
+
+            for (size_t i = 0; i < tracks.size(); i++)
+            {
+                auto &track = tracks[i];
+                fileStream << i << delimiter << track.firstTimestep << delimiter << track.lastTimestep << delimiter
+                           << track.GetLifetime() << delimiter << track.framesCount << delimiter << track.maxLength
+                           << delimiter << track.isAlive << "\n";
+            }
+        }
+
+        // Writes a row for each event, tracks before and after it
+        // are separated by spaces.
+        auto WriteEventsCsv(std::string fileName, bool withHeaders, std::string delimiter) const
+        {
+            std::ofstream fileStream(fileName);
+            if (!fileStream)
+                throw std::runtime_error("\n Error: Cannot write the below file:\n" + fileName);
+
+            if (withHeaders)
+                fileStream << "timestep" << delimiter << "event" << delimiter
+                           << "fromTracks" << delimiter << "toTracks" << "\n";
+
+            const char *names[] = {"birth", "death", "split", "merge"};
+            auto writeTracks = [&](const std::vector<size_t> &trackIds)
+            {
+                for (size_t i = 0; i < trackIds.size(); i++)
+                    fileStream << (i ? " " : "") << trackIds[i];
+            };
+            for (auto &event : events)
+            {
+                fileStream << event.timestep << delimiter << names[int(event.type)] << delimiter;
+                writeTracks(event.fromTracks);
+                fileStream << delimiter;
+                writeTracks(event.toTracks);
+                fileStream << "\n";
+            }
+        }
+    };
+}
+
+#endif // CHAINTRACKER_H
@@ -20,7 +20,11 @@
 # along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifndef CHAINSIO_H
+#define CHAINSIO_H
+
 #include "particle.h"
+#include "contactGraph.h"
 
 #include <vtkCellArray.h>
 #include <vtkNew.h>
@@ -34,19 +38,35 @@ namespace ForceChain
 {
 
     // Write chains in CSV and VTP format.
-    class ChainsIo
+    template <typename Scalar>
+    class BasicChainsIo
     {
-        const std::vector<Particle> &particles;
+        using Particle = BasicParticle<Scalar>;
+
         const std::vector<std::vector<size_t>> &chains;
+        const BasicParticles<Scalar> &particles;
+        // linkNodes of particles, written by WriteCsv.
+        const ChainLinks &links;
 
     public:
-        ChainsIo(const std::vector<std::vector<size_t>> &chains_,const std::vector<Particle> &particles_)
-            : chains(chains_), particles(particles_) {}
+        BasicChainsIo(const std::vector<std::vector<size_t>> &chains_,const BasicParticles<Scalar> &particles_,
+                      const ChainLinks &links_)
+            : chains(chains_), particles(particles_), links(links_) {}
 
         // Write paraview readable format for chains that
         // their id is given.
         auto WriteFilteredVtp(std::string fileName,
                               const std::vector<size_t> &chainIds)
+        {
+            WriteVtpOf(fileName, chains, chainIds, [&](size_t i)
+                       { return particles[i]; });
+        }
+
+        // WriteFilteredVtp of chains whose items are indices of
+        // particles given by particleOf(index), as a BasicParticle.
+        template <typename ParticleOf>
+        static void WriteVtpOf(std::string fileName, const std::vector<std::vector<size_t>> &chains,
+                               const std::vector<size_t> &chainIds, ParticleOf particleOf)
         {
             vtkNew<vtkPoints> points;
 
@@ -68,6 +88,8 @@ namespace ForceChain
 
             int id[1] = {0};
             int chainId_out[1] = {0};
+            double radius[1] = {0};
+            double minorStress[1] = {0};
 
             for (auto &&chainId : chainIds)
             {
@@ -75,7 +97,7 @@ namespace ForceChain
                 for (auto &&particleId : chains[chainId])
                 {
 
-                    auto &particle = particles[particleId];
+                    auto particle = particleOf(particleId);
 
                     auto pos = particle.position;
                     points->InsertNextPoint(pos[0], pos[1], pos[2]);
@@ -85,8 +107,10 @@ namespace ForceChain
 
                     ids->InsertNextTypedTuple(id);
                     chainIds_out->InsertNextTypedTuple(chainId_out);
-                    radii->InsertNextTypedTuple(&particle.radius);
-                    minorStresses->InsertNextTypedTuple(&particle.minorStress);
+                    radius[0] = particle.radius;
+                    minorStress[0] = particle.minorStress;
+                    radii->InsertNextTypedTuple(radius);
+                    minorStresses->InsertNextTypedTuple(minorStress);
                 }
             }
 
@@ -222,7 +246,7 @@ namespace ForceChain
                 std::cout << "(" << ++id << ") ";
                 for (auto &&item : chain)
                 {
-                    std::cout << item << " ";
+                    std::cout << particles[item].id << " ";
                     sum += particles[item].id;
                 }
                 std::cout << "\n";
@@ -238,88 +262,103 @@ namespace ForceChain
             std::ofstream fileStream(fileName);
 
             if (withHeaders)
-            {
-                fileStream << "LiggghtsId" << delimiter
-                           << "X" << delimiter
-                           << "Y" << delimiter
-                           << "Z" << delimiter
-                           << "radius" << delimiter
-                           << "chainId" << delimiter
-                           << "minorStress" << delimiter
-                           << "minorDirX" << delimiter
-                           << "minorDirY" << delimiter
-                           << "minorDirZ" << delimiter
-                           << "PrincipleStress0" << delimiter
-                           << "PrincipleStress1" << delimiter
-                           << "PrincipleStress2" << delimiter
-                           // first dir
-                           << "StressDir00" << delimiter
-                           << "StressDir10" << delimiter
-                           << "StressDir20" << delimiter
-                           // 2nd dir
-                           << "StressDir01" << delimiter
-                           << "StressDir11" << delimiter
-                           << "StressDir21" << delimiter
-                           // 3rd dir
-                           << "StressDir02" << delimiter
-                           << "StressDir12" << delimiter
-                           << "StressDir22" << delimiter
-                           << "linkNodes"    << delimiter
-
-                           << "\n";
-            }
+                WriteCsvHeader(fileStream, delimiter);
 
             // Write to the file
-            for (auto &particle : particles)
+            for (size_t iParticle = 0; iParticle < particles.size(); iParticle++)
             {
+                auto particle = particles[iParticle];
                 if (particle.chainId==-1){
                     continue;
                 }
-             
-                const auto realPrincipleStresses = particle.GetRealPrincipleStresses();
-                const auto realPrincipleDirs = particle.GetRealPrincipleDirs();
-
-                fileStream << particle.id << delimiter
-                            << particle.position(0) << delimiter
-                            << particle.position(1) << delimiter
-                            << particle.position(2) << delimiter
-                            << particle.radius << delimiter
-                            << particle.chainId << delimiter
-                            << particle.minorStress << delimiter
-                            << particle.minorDir[0] << delimiter
-                            << particle.minorDir[1] << delimiter
-                            << particle.minorDir[2] << delimiter
-                            << realPrincipleStresses[0] << delimiter
-                            << realPrincipleStresses[1] << delimiter
-                            << realPrincipleStresses[2] << delimiter;
-
-                for (size_t k = 0; k < 3; k++)
-                {
-                    for (size_t j = 0; j < 3; j++)
-                    {
-                        fileStream << realPrincipleDirs(j, k) << delimiter;
-                    }
-                }
+                WriteCsvRow(fileStream, particle, links.linkNodes.GetRow(iParticle), delimiter);
+            }
 
-                if (particle.linkNodes.size()==0)
-                    fileStream << "starting" << delimiter;
-
-                else {
-                    fileStream << "\"";
-                    for (size_t i = 0; i < particle.linkNodes.size(); i++) {
-                        fileStream << particle.linkNodes[i] ;
-                        if (i != particle.linkNodes.size() - 1)
-                            fileStream << ",";
-                    }   
-                    fileStream << "\"";
-                    fileStream << delimiter;
+            fileStream.close();
+        }
+
+        // The header line of WriteCsv.
+        static void WriteCsvHeader(std::ostream &fileStream, std::string delimiter)
+        {
+            fileStream << "LiggghtsId" << delimiter
+                       << "X" << delimiter
+                       << "Y" << delimiter
+                       << "Z" << delimiter
+                       << "radius" << delimiter
+                       << "chainId" << delimiter
+                       << "minorStress" << delimiter
+                       << "minorDirX" << delimiter
+                       << "minorDirY" << delimiter
+                       << "minorDirZ" << delimiter
+                       << "PrincipleStress0" << delimiter
+                       << "PrincipleStress1" << delimiter
+                       << "PrincipleStress2" << delimiter
+                       // first dir
+                       << "StressDir00" << delimiter
+                       << "StressDir10" << delimiter
+                       << "StressDir20" << delimiter
+                       // 2nd dir
+                       << "StressDir01" << delimiter
+                       << "StressDir11" << delimiter
+                       << "StressDir21" << delimiter
+                       // 3rd dir
+                       << "StressDir02" << delimiter
+                       << "StressDir12" << delimiter
+                       << "StressDir22" << delimiter
+                       << "linkNodes"    << delimiter
+
+                       << "\n";
+        }
+
+        // The line of a particle of a chain in WriteCsv.
+        static void WriteCsvRow(std::ostream &fileStream, const Particle &particle,
+                                CsrRows<int64_t>::Row linkNodes, std::string delimiter)
+        {
+            const auto realPrincipleStresses = particle.GetRealPrincipleStresses();
+            const auto realPrincipleDirs = particle.GetRealPrincipleDirs();
+
+            fileStream << particle.id << delimiter
+                        << particle.position(0) << delimiter
+                        << particle.position(1) << delimiter
+                        << particle.position(2) << delimiter
+                        << particle.radius << delimiter
+                        << particle.chainId << delimiter
+                        << particle.minorStress << delimiter
+                        << particle.minorDir[0] << delimiter
+                        << particle.minorDir[1] << delimiter
+                        << particle.minorDir[2] << delimiter
+                        << realPrincipleStresses[0] << delimiter
+                        << realPrincipleStresses[1] << delimiter
+                        << realPrincipleStresses[2] << delimiter;
+
+            for (size_t k = 0; k < 3; k++)
+            {
+                for (size_t j = 0; j < 3; j++)
+                {
+                    fileStream << realPrincipleDirs(j, k) << delimiter;
                 }
+            }
 
-                fileStream << "\n";
+            if (linkNodes.size()==0)
+                fileStream << "starting" << delimiter;
+
+            else {
+                fileStream << "\"";
+                for (size_t i = 0; i < linkNodes.size(); i++) {
+                    fileStream << linkNodes[i] ;
+                    if (i != linkNodes.size() - 1)
+                        fileStream << ",";
+                }   
+                fileStream << "\"";
+                fileStream << delimiter;
             }
 
-            fileStream.close();
+            fileStream << "\n";
         }
 
     };
-}
\ No newline at end of file
+
+    using ChainsIo = BasicChainsIo<double>;
+}
+
+#endif // CHAINSIO_H
@@ -0,0 +1,361 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPRESSEDINPUT_H
+#define COMPRESSEDINPUT_H
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <cstdio>
+#include <vector>
+#include <memory>
+#include <zlib.h>
+#ifdef FORCECHAIN_WITH_ZSTD
+#include <zstd.h>
+#endif
+#include "boundedQueue.h"
+#include "textCursor.h"
+
+namespace ForceChain
+{
+    // True if the file name ends with an extension of a compression
+    // format that the readers decompress on the fly: .gz or .zst
+    bool IsCompressed(const std::string &fileName)
+    {
+        return fileName.ends_with(".gz") || fileName.ends_with(".zst");
+    }
+
+    // Decompresses gzip files, or plain files, by zlib.
+    class GzipDecoder
+    {
+        gzFile file;
+
+    public:
+        GzipDecoder(const std::string &fileName)
+        {
+            file = gzopen(fileName.c_str(), "rb");
+            if (file == nullptr)
+                throw std::runtime_error("\n Error: The below file does not exist:\n" + fileName);
+            gzbuffer(file, 1 << 20);
+        }
+
+        GzipDecoder(const GzipDecoder &) = delete;
+        GzipDecoder &operator=(const GzipDecoder &) = delete;
+
+        ~GzipDecoder()
+        {
+            gzclose(file);
+        }
+
+        // Fills buffer and returns the number of bytes written to it,
+        // zero at the end of file.
+        size_t Read(char *buffer, size_t size)
+        {
+            auto count = gzread(file, buffer, size);
+            if (count < 0)
+            {
+                int errorNumber;
+                throw std::runtime_error(std::string("\n Error: gzip decompression failed: ") +
+                                         gzerror(file, &errorNumber));
+            }
+            return count;
+        }
+    };
+
+#ifdef FORCECHAIN_WITH_ZSTD
+    // Decompresses zstd files by libzstd streaming API.
+    class ZstdDecoder
+    {
+        FILE *file;
+        ZSTD_DStream *stream;
+        std::vector<char> input;
+        ZSTD_inBuffer inBuffer{nullptr, 0, 0};
+        bool isFileDone = false;
+        // Result of the last call that read or wrote bytes, 0 once a
+        // frame is complete, so a file ending with another value is
+        // truncated.
+        size_t lastResult = 0;
+        std::string fileName;
+
+    public:
+        ZstdDecoder(const std::string &fileName_) : input(ZSTD_DStreamInSize()), fileName(fileName_)
+        {
+            file = std::fopen(fileName.c_str(), "rb");
+            if (file == nullptr)
+                throw std::runtime_error("\n Error: The below file does not exist:\n" + fileName);
+            stream = ZSTD_createDStream();
+            ZSTD_initDStream(stream);
+            inBuffer.src = input.data();
+        }
+
+        ZstdDecoder(const ZstdDecoder &) = delete;
+        ZstdDecoder &operator=(const ZstdDecoder &) = delete;
+
+        ~ZstdDecoder()
+        {
+            ZSTD_freeDStream(stream);
+            std::fclose(file);
+        }
+
+        size_t Read(char *buffer, size_t size)
+        {
+            ZSTD_outBuffer outBuffer{buffer, size, 0};
+            while (outBuffer.pos < outBuffer.size)
+            {
+                if (inBuffer.pos == inBuffer.size && !isFileDone)
+                {
+                    inBuffer.size = std::fread(input.data(), 1, input.size(), file);
+                    inBuffer.pos = 0;
+                    isFileDone = inBuffer.size == 0;
+                }
+
+                // With no input left, it still flushes what the
+                // decoder holds, until it makes no progress.
+                auto outputBefore = outBuffer.pos;
+                auto inputBefore = inBuffer.pos;
+                auto result = ZSTD_decompressStream(stream, &outBuffer, &inBuffer);
+                if (ZSTD_isError(result))
+                    throw std::runtime_error(std::string("\n Error: zstd decompression failed: ") +
+                                             ZSTD_getErrorName(result));
+                if (outBuffer.pos != outputBefore || inBuffer.pos != inputBefore)
+                    lastResult = result;
+                if (isFileDone && outBuffer.pos == outputBefore)
+                {
+                    if (lastResult != 0)
+                        throw std::runtime_error("\n Error: zstd decompression failed: truncated zstd stream of the below file:\n" + fileName);
+                    break;
+                }
+            }
+            return outBuffer.pos;
+        }
+    };
+#endif
+
+    // Decompresses a .gz or .zst file in a background thread and gives
+    // its text in chunks which end at the end of a line. While a chunk
+    // is parsed the next ones are decompressed, so decompression is not
+    // a separate pass over the file. At most queueDepth chunks wait in
+    // memory.
+    class DecompressedChunks
+    {
+        BoundedQueue<std::string> queue;
+        std::thread worker;
+        std::exception_ptr error;
+        std::string current;
+
+        // Decompresses into chunks of about chunkSize bytes. The part
+        // of a line at the end of a chunk is moved to the next one.
+        template <typename Decoder>
+        void Produce(Decoder &decoder, size_t chunkSize)
+        {
+            std::string leftover;
+            while (true)
+            {
+                std::string chunk = std::move(leftover);
+                leftover.clear();
+                auto start = chunk.size();
+                chunk.resize(start + chunkSize);
+                auto count = decoder.Read(chunk.data() + start, chunkSize);
+                chunk.resize(start + count);
+
+                if (count == 0)
+                {
+                    if (!chunk.empty())
+                        queue.Push(std::move(chunk));
+                    return;
+                }
+
+                auto lastLineEnd = chunk.rfind('\n');
+                if (lastLineEnd == std::string::npos)
+                {
+                    // A line longer than a chunk, keep on reading it.
+                    leftover = std::move(chunk);
+                    continue;
+                }
+                leftover.assign(chunk, lastLineEnd + 1);
+                chunk.resize(lastLineEnd + 1);
+
+                if (!queue.Push(std::move(chunk)))
+                    return;
+            }
+        }
+
+        template <typename Decoder>
+        void Start(std::unique_ptr<Decoder> decoder, size_t chunkSize)
+        {
+            worker = std::thread([this, chunkSize, decoder = std::move(decoder)]
+                                 {
+                try
+                {
+                    Produce(*decoder, chunkSize);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+                queue.Close(); });
+        }
+
+    public:
+        DecompressedChunks(std::string fileName, size_t chunkSize = 1 << 22, size_t queueDepth = 4)
+            : queue(queueDepth)
+        {
+            if (fileName.ends_with(".zst"))
+            {
+#ifdef FORCECHAIN_WITH_ZSTD
+                Start(std::make_unique<ZstdDecoder>(fileName), chunkSize);
+#else
+                throw std::runtime_error("\n Error: Built without zstd support, cannot read:\n" + fileName);
+#endif
+            }
+            else
+                Start(std::make_unique<GzipDecoder>(fileName), chunkSize);
+        }
+
+        DecompressedChunks(const DecompressedChunks &) = delete;
+        DecompressedChunks &operator=(const DecompressedChunks &) = delete;
+
+        ~DecompressedChunks()
+        {
+            queue.Close();
+            if (worker.joinable())
+                worker.join();
+        }
+
+        // Gives the next chunk, valid until the next call.
+        // Returns false at the end of file.
+        bool Next(std::string_view &chunk)
+        {
+            if (!queue.Pop(current))
+            {
+                if (worker.joinable())
+                    worker.join();
+                if (error)
+                    std::rethrow_exception(error);
+                return false;
+            }
+            chunk = current;
+            return true;
+        }
+    };
+
+    // The same reading functions of TextCursor but over the chunks of
+    // DecompressedChunks, so the frame readers accept compressed input.
+    // Chunks end at line ends, a new chunk is fetched only when the
+    // cursor is at the start of a line.
+    class ChunkCursor
+    {
+        DecompressedChunks &chunks;
+        TextCursor cursor;
+        bool isDone = false;
+
+        // Fetches the next chunk if the current one is consumed.
+        void Refill()
+        {
+            std::string_view chunk;
+            while (!isDone && cursor.AtEnd())
+            {
+                if (chunks.Next(chunk))
+                    cursor = TextCursor(chunk);
+                else
+                    isDone = true;
+            }
+        }
+
+    public:
+        ChunkCursor(DecompressedChunks &chunks_) : chunks(chunks_), cursor(std::string_view()) {}
+
+        bool AtEnd()
+        {
+            Refill();
+            return cursor.AtEnd();
+        }
+
+        bool StartsWith(std::string_view prefix)
+        {
+            Refill();
+            return cursor.StartsWith(prefix);
+        }
+
+        std::string_view ReadLine()
+        {
+            Refill();
+            return cursor.ReadLine();
+        }
+
+        void SkipLine()
+        {
+            Refill();
+            cursor.SkipLine();
+        }
+
+        // The below may be called at the start of a line too, so they
+        // refill. Refill does nothing inside a line.
+        bool AtEndOfLine()
+        {
+            Refill();
+            return cursor.AtEndOfLine();
+        }
+
+        void SkipBlanks()
+        {
+            Refill();
+            cursor.SkipBlanks();
+        }
+
+        bool ReadDouble(double &value)
+        {
+            Refill();
+            return cursor.ReadDouble(value);
+        }
+
+        template <typename Integer>
+        bool ReadInteger(Integer &value)
+        {
+            Refill();
+            return cursor.ReadInteger(value);
+        }
+
+        bool ReadBool(bool &value)
+        {
+            Refill();
+            return cursor.ReadBool(value);
+        }
+
+        void SkipToken()
+        {
+            Refill();
+            cursor.SkipToken();
+        }
+
+        std::string_view ReadToken()
+        {
+            Refill();
+            return cursor.ReadToken();
+        }
+    };
+}
+
+#endif // COMPRESSEDINPUT_H
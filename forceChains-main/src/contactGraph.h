@@ -0,0 +1,197 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTACTGRAPH_H
+#define CONTACTGRAPH_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "contactTable.h"
+#include "parallelFor.h"
+#include "particle.h"
+#include "periodicCorrection.h"
+
+namespace ForceChain
+{
+    // Rows of values in compressed sparse row (CSR) form: row i is
+    // values[offsets[i]] to values[offsets[i + 1] - 1]. All the rows
+    // are in two arrays, instead of a heap block per row.
+    template <typename T>
+    struct CsrRows
+    {
+        std::vector<size_t> offsets{0};
+        std::vector<T> values;
+
+        // A row, usable in range for.
+        struct Row
+        {
+            const T *first;
+            const T *last;
+
+            auto begin() const { return first; }
+            auto end() const { return last; }
+            auto size() const { return size_t(last - first); }
+            auto &operator[](size_t k) const { return first[k]; }
+        };
+
+        auto RowsCount() const
+        {
+            return offsets.size() - 1;
+        }
+
+        auto GetRow(size_t i) const
+        {
+            return Row{values.data() + offsets[i], values.data() + offsets[i + 1]};
+        }
+
+        void Clear()
+        {
+            offsets.assign(1, 0);
+            values.clear();
+        }
+    };
+
+    // Pair contacts as a graph of particles. Row i lists the ids of
+    // particles touching particle i, in the order of their contacts in
+    // the table. Edge k is values[k], a pair of particles touching
+    // each other has an edge in both rows. Wall contacts add no edge.
+    using ContactGraph = CsrRows<uint32_t>;
+
+    // Builds graph of particlesCount particles from contacts in two
+    // passes: rows are counted, offsets are prefix summed, then rows
+    // are filled. Like AddContacts, contact ends go to the thread
+    // owning their particle, see ForEachOwnedEnd, so rows keep the
+    // table order and no two threads write to one row.
+    // threadsCount = 0 uses all cores.
+    void BuildContactGraph(size_t particlesCount, const ContactTable &contacts, ContactGraph &graph,
+                           size_t threadsCount = 1)
+    {
+        const size_t blockSize = 1024;
+        const size_t windowSize = 64 * blockSize;
+        auto contactsCount = contacts.Size();
+        if (threadsCount == 0)
+            threadsCount = DefaultThreadsCount();
+        threadsCount = std::max<size_t>(1, std::min(threadsCount, contactsCount / blockSize + 1));
+
+        auto &offsets = graph.offsets;
+        auto &values = graph.values;
+        auto firstOwned = [&](size_t iThread)
+        { return particlesCount * iThread / threadsCount; };
+
+        auto noShare = [](size_t, size_t, size_t) {};
+        auto endOf = [&](size_t iContact, bool isSecond) -> size_t
+        { return isSecond ? contacts.id2[iContact] : contacts.id1[iContact]; };
+        auto otherEndOf = [&](size_t iContact, bool isSecond) -> size_t
+        { return isSecond ? contacts.id1[iContact] : contacts.id2[iContact]; };
+
+        // Size of row i is counted in offsets[i + 1].
+        offsets.assign(particlesCount + 1, 0);
+        ForEachOwnedEnd(contacts, particlesCount, threadsCount, windowSize, noShare,
+                        [&](size_t iContact, bool isSecond)
+                        {
+            if (contacts.id2[iContact] != ContactTable::wallId)
+                offsets[endOf(iContact, isSecond) + 1]++; });
+
+        // Each thread sums its own range, then adds the total of the
+        // ranges before it.
+        std::vector<size_t> rangeOffsets(threadsCount + 1, 0);
+        ParallelFor(threadsCount, [&](size_t iThread)
+                    {
+            size_t first = firstOwned(iThread), last = firstOwned(iThread + 1);
+            for (auto i = first + 1; i < last; i++)
+                offsets[i + 1] += offsets[i];
+            rangeOffsets[iThread + 1] = last > first ? offsets[last] : 0; });
+        for (size_t iThread = 0; iThread < threadsCount; iThread++)
+            rangeOffsets[iThread + 1] += rangeOffsets[iThread];
+        ParallelFor(threadsCount, [&](size_t iThread)
+                    {
+            size_t first = firstOwned(iThread), last = firstOwned(iThread + 1);
+            for (auto i = first; i < last; i++)
+                offsets[i + 1] += rangeOffsets[iThread]; });
+
+        values.resize(offsets[particlesCount]);
+        // Next free edge of each row.
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        ForEachOwnedEnd(contacts, particlesCount, threadsCount, windowSize, noShare,
+                        [&](size_t iContact, bool isSecond)
+                        {
+            if (contacts.id2[iContact] != ContactTable::wallId)
+                values[next[endOf(iContact, isSecond)]++] = otherEndOf(iContact, isSecond); });
+    }
+
+    // Vector of every edge of a ContactGraph, from the particle of its
+    // row to the neighbor, or to its periodic image next to it. They
+    // are found once per frame, see SetEdgeBranches, so the angle
+    // checks of chain searches read them instead of finding periodic
+    // images again.
+    template <typename Scalar>
+    using EdgeBranches = std::vector<Eigen::Matrix<Scalar, 3, 1>>;
+
+    // Sets branches of all the edges of graph of particles, rows are
+    // shared by threads. box is the low and upper bounds of the
+    // simulation box. threadsCount = 0 uses all cores.
+    template <typename Scalar>
+    void SetEdgeBranches(const BasicParticles<Scalar> &particles, const ContactGraph &graph,
+                         const std::vector<std::vector<double>> &box, EdgeBranches<Scalar> &branches,
+                         size_t threadsCount = 1)
+    {
+        const size_t blockSize = 65536;
+        auto particlesCount = graph.RowsCount();
+        if (threadsCount == 0)
+            threadsCount = DefaultThreadsCount();
+        threadsCount = std::max<size_t>(1, std::min(threadsCount, graph.values.size() / blockSize + 1));
+
+        branches.resize(graph.values.size());
+        ParallelFor(threadsCount, [&](size_t iThread)
+                    {
+            auto first = particlesCount * iThread / threadsCount;
+            auto last = particlesCount * (iThread + 1) / threadsCount;
+            for (auto ilink = first; ilink < last; ilink++)
+            {
+                auto link = particles[ilink];
+                for (auto edge = graph.offsets[ilink]; edge < graph.offsets[ilink + 1]; edge++)
+                {
+                    auto nei = particles[graph.values[edge]];
+                    branches[edge] = GetContactImage(link.position, nei.position, nei.radius + link.radius,
+                                                     box[0], box[1]) - link.position;
+                }
+            } });
+    }
+
+    // Links found by the chain search on a ContactGraph, see
+    // BasicChainFinder.
+    struct ChainLinks
+    {
+        // One flag per edge of the graph, set if its two particles are
+        // linked in a chain, whichever of them found the other.
+        std::vector<uint8_t> isLinked;
+
+        // Row i lists LIGGGHTS ids of the particles particle i was
+        // linked from, in the order they were found. A chain of two
+        // particles is dropped and the entry of its second particle is
+        // negated.
+        CsrRows<int64_t> linkNodes;
+    };
+}
+
+#endif // CONTACTGRAPH_H
@@ -0,0 +1,198 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTACTSTRESS_H
+#define CONTACTSTRESS_H
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <Eigen/Dense>
+#include "particle.h"
+#include "contactTable.h"
+#include "parallelFor.h"
+
+namespace ForceChain
+{
+    template <typename Scalar>
+    void ResetStressAndForce(BasicParticles<Scalar> &particles)
+    {
+        for (auto &&particle : particles)
+        {
+            particle.stress.setZero();
+            particle.force.setZero();
+        }
+    }
+
+    // Contract: Compressive stress is negative.
+    // f12 is the force acting on particle 1.
+    // x12 is toward center of particle 1, i.e.
+    // it is in the direction of compressive force
+    // acting on particle 1.
+    // -f12.x12 = is in direction of negative compression
+    // which is used here.
+    //
+    // The stress a contact adds to a particle of radius r and volume V
+    // is f12 (x) (-x12) * (r - overlap/2) / V, and the opposite force
+    // gives particle 2 the same tensor with its own r and V.
+    //
+    // Row k of first and second holds the stress contact begin+k adds
+    // to particle 1 and 2, column 3*i+j is component (i,j). Every
+    // column is computed over all the contacts at once, as Eigen
+    // arrays, so the compiler uses SIMD lanes across contacts.
+    using ContactStresses = Eigen::Array<double, Eigen::Dynamic, 9>;
+
+    template <typename Scalar>
+    void ComputeContactStresses(const BasicParticles<Scalar> &particles, const ContactTable &contacts,
+                                size_t begin, size_t end,
+                                ContactStresses &first, ContactStresses &second, size_t row)
+    {
+        auto count = end - begin;
+        Eigen::ArrayXd radius1(count), radius2(count);
+        for (size_t k = 0; k < count; k++)
+        {
+            auto id2 = contacts.id2[begin + k];
+            radius1[k] = particles.hot[contacts.id1[begin + k]].radius;
+            radius2[k] = id2 == ContactTable::wallId ? 1. : particles.hot[id2].radius;
+        }
+
+        auto column = [&](const std::vector<double> &values)
+        { return Eigen::Map<const Eigen::ArrayXd>(values.data() + begin, count); };
+
+        auto overlap = column(contacts.overlap);
+        Eigen::ArrayXd arm1 = radius1 - overlap / 2.;
+        Eigen::ArrayXd arm2 = radius2 - overlap / 2.;
+        Eigen::ArrayXd vol1 = 4. / 3. * M_PI * radius1 * radius1 * radius1;
+        Eigen::ArrayXd vol2 = 4. / 3. * M_PI * radius2 * radius2 * radius2;
+
+        for (size_t i = 0; i < 3; i++)
+        {
+            auto f = column(contacts.f12[i]);
+            for (size_t j = 0; j < 3; j++)
+            {
+                auto x = column(contacts.x12[j]);
+                first.col(3 * i + j).segment(row, count) = f * (-x) * arm1 / vol1;
+                second.col(3 * i + j).segment(row, count) = -f * x * arm2 / vol2;
+            }
+        }
+    }
+
+    // Adds forces and stresses of the contacts to their particles, in
+    // the order of the table. Wall contacts touch only their particle.
+    // Stress and force are summed to the current ones, see
+    // ResetStressAndForce. Neighbors are in a ContactGraph, see
+    // BuildContactGraph.
+    //
+    // Contacts are done in windows: the stresses of a window are
+    // computed by all threads, each on its own share of contacts,
+    // then each thread adds them to the particles it owns, see
+    // ForEachOwnedEnd. No two threads write to one particle and every
+    // particle gets its contacts in the table order, so the result is
+    // identical, bit by bit, for any threadsCount. 0 uses all cores.
+    //
+    // Float particles are summed in double, each particle's current
+    // stress and force are taken to double first and the sums are
+    // rounded to float once, after all the contacts.
+    template <typename Scalar>
+    void AddContacts(BasicParticles<Scalar> &particles, const ContactTable &contacts,
+                     size_t threadsCount = 1)
+    {
+        constexpr bool isDouble = std::is_same_v<Scalar, double>;
+        const size_t blockSize = 1024;
+        const size_t windowSize = 64 * blockSize;
+
+        auto contactsCount = contacts.Size();
+        if (threadsCount == 0)
+            threadsCount = DefaultThreadsCount();
+        threadsCount = std::max<size_t>(1, std::min(threadsCount, contactsCount / blockSize + 1));
+
+        auto windowRows = std::min(windowSize, contactsCount);
+        ContactStresses first(windowRows, 9), second(windowRows, 9);
+        auto particlesCount = particles.size();
+
+        std::vector<Eigen::Matrix3d> stressSums(isDouble ? 0 : particlesCount);
+        std::vector<Eigen::Vector3d> forceSums(isDouble ? 0 : particlesCount);
+        auto stressOf = [&](size_t id) -> Eigen::Matrix3d &
+        {
+            if constexpr (isDouble)
+                return particles.cold[id].stress;
+            else
+                return stressSums[id];
+        };
+        auto forceOf = [&](size_t id) -> Eigen::Vector3d &
+        {
+            if constexpr (isDouble)
+                return particles.cold[id].force;
+            else
+                return forceSums[id];
+        };
+
+        if constexpr (!isDouble)
+        {
+            for (size_t id = 0; id < particlesCount; id++)
+            {
+                stressSums[id] = particles.cold[id].stress.template cast<double>();
+                forceSums[id] = particles.cold[id].force.template cast<double>();
+            }
+        }
+
+        // Windows start at multiples of windowSize, contact iContact is
+        // row iContact % windowSize of first and second.
+        auto computeStresses = [&](size_t, size_t begin, size_t end)
+        {
+            for (auto blockBegin = begin; blockBegin < end; blockBegin += blockSize)
+            {
+                auto blockEnd = std::min(blockBegin + blockSize, end);
+                ComputeContactStresses(particles, contacts, blockBegin, blockEnd,
+                                       first, second, blockBegin % windowSize);
+            }
+        };
+
+        auto addEnd = [&](size_t iContact, bool isSecond)
+        {
+            auto row = iContact % windowSize;
+            size_t id = isSecond ? contacts.id2[iContact] : contacts.id1[iContact];
+            double sign = isSecond ? -1. : 1.;
+            auto &stresses = isSecond ? second : first;
+            auto &force = forceOf(id);
+            auto &stress = stressOf(id);
+            for (size_t i = 0; i < 3; i++)
+                force(i) += sign * contacts.f12[i][iContact];
+            for (size_t i = 0; i < 3; i++)
+                for (size_t j = 0; j < 3; j++)
+                    stress(i, j) += stresses(row, 3 * i + j);
+        };
+
+        ForEachOwnedEnd(contacts, particlesCount, threadsCount, windowSize, computeStresses, addEnd);
+
+        if constexpr (!isDouble)
+        {
+            for (size_t id = 0; id < particlesCount; id++)
+            {
+                particles.cold[id].stress = stressSums[id].template cast<Scalar>();
+                particles.cold[id].force = forceSums[id].template cast<Scalar>();
+            }
+        }
+    }
+}
+
+#endif // CONTACTSTRESS_H
@@ -0,0 +1,211 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTACTTABLE_H
+#define CONTACTTABLE_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <Eigen/Dense>
+#include "parallelFor.h"
+
+namespace ForceChain
+{
+    // One pair interaction of a liggghts pair file, ready to be added
+    // to its particles.
+    struct PairContact
+    {
+        int id1, id2;
+        // force acting on particle 1 due to 2
+        Eigen::Vector3d f12;
+        // unit vector from particle 2 toward center of particle 1
+        Eigen::Vector3d x12;
+        double overlap;
+    };
+
+    // Contacts of one frame stored column by column, each quantity in
+    // its own contiguous array, so kernels can run over many contacts
+    // at once. See AddContacts for their stresses.
+    // id1 and id2 are indices of particles, not their LIGGGHTS ids,
+    // see ParticleIdMap. A wall contact has id2 = wallId, id1 is its
+    // particle and x12 points from the wall toward the particle.
+    class ContactTable
+    {
+    public:
+        static constexpr int wallId = -1;
+
+        std::vector<int> id1, id2;
+        std::array<std::vector<double>, 3> x12;
+        std::array<std::vector<double>, 3> f12;
+        std::vector<double> overlap;
+
+        auto Size() const
+        {
+            return id1.size();
+        }
+
+        void Clear()
+        {
+            Resize(0);
+        }
+
+        void Reserve(size_t count)
+        {
+            id1.reserve(count);
+            id2.reserve(count);
+            for (size_t i = 0; i < 3; i++)
+            {
+                x12[i].reserve(count);
+                f12[i].reserve(count);
+            }
+            overlap.reserve(count);
+        }
+
+        void Resize(size_t count)
+        {
+            id1.resize(count);
+            id2.resize(count);
+            for (size_t i = 0; i < 3; i++)
+            {
+                x12[i].resize(count);
+                f12[i].resize(count);
+            }
+            overlap.resize(count);
+        }
+
+        void Add(const PairContact &contact)
+        {
+            id1.push_back(contact.id1);
+            id2.push_back(contact.id2);
+            for (size_t i = 0; i < 3; i++)
+            {
+                x12[i].push_back(contact.x12[i]);
+                f12[i].push_back(contact.f12[i]);
+            }
+            overlap.push_back(contact.overlap);
+        }
+
+        // Adds the contacts of other after the ones of this.
+        void Append(const ContactTable &other)
+        {
+            auto append = [](auto &to, const auto &from)
+            { to.insert(to.end(), from.begin(), from.end()); };
+
+            append(id1, other.id1);
+            append(id2, other.id2);
+            for (size_t i = 0; i < 3; i++)
+            {
+                append(x12[i], other.x12[i]);
+                append(f12[i], other.f12[i]);
+            }
+            append(overlap, other.overlap);
+        }
+
+        PairContact Get(size_t iContact) const
+        {
+            return {id1[iContact], id2[iContact],
+                    Eigen::Vector3d(f12[0][iContact], f12[1][iContact], f12[2][iContact]),
+                    Eigen::Vector3d(x12[0][iContact], x12[1][iContact], x12[2][iContact]),
+                    overlap[iContact]};
+        }
+    };
+
+    // Runs onEnd(iContact, isSecond) for the two ends of every contact,
+    // id1 and then id2, on the thread owning the particle of the end.
+    // Wall ends are skipped. Particle i is owned by thread
+    // i * threadsCount / particlesCount, so no two threads get one
+    // particle and every particle gets its ends in the table order.
+    //
+    // Contacts are taken in windows of windowSize. In each window every
+    // thread runs onShare(iThread, begin, end) on an equal share of it
+    // and sorts the ends of the share into a bucket per owner, in one
+    // pass. Then each thread runs the buckets it owns, in the order of
+    // the shares. So the work is one pass over the contacts for any
+    // threadsCount, and one set of threads does all the windows.
+    template <typename OnShare, typename OnEnd>
+    void ForEachOwnedEnd(const ContactTable &contacts, size_t particlesCount, size_t threadsCount,
+                         size_t windowSize, OnShare onShare, OnEnd onEnd)
+    {
+        auto contactsCount = contacts.Size();
+        if (contactsCount == 0)
+            return;
+        threadsCount = std::max<size_t>(1, threadsCount);
+
+        if (threadsCount == 1)
+        {
+            for (size_t windowBegin = 0; windowBegin < contactsCount; windowBegin += windowSize)
+            {
+                auto windowEnd = std::min(windowBegin + windowSize, contactsCount);
+                onShare(size_t(0), windowBegin, windowEnd);
+                for (auto iContact = windowBegin; iContact < windowEnd; iContact++)
+                {
+                    onEnd(iContact, false);
+                    if (contacts.id2[iContact] != ContactTable::wallId)
+                        onEnd(iContact, true);
+                }
+            }
+            return;
+        }
+
+        // Ends of the window that thread t sends to owner o are in
+        // buckets[t * threadsCount + o], as row * 2 + isSecond.
+        std::vector<std::vector<uint32_t>> buckets(threadsCount * threadsCount);
+        auto ownerOf = [&](size_t id)
+        { return id * threadsCount / particlesCount; };
+
+        ParallelSteps(threadsCount, [&](size_t iThread, auto sync)
+                      {
+            auto sent = buckets.begin() + iThread * threadsCount;
+            for (size_t windowBegin = 0; windowBegin < contactsCount; windowBegin += windowSize)
+            {
+                auto windowEnd = std::min(windowBegin + windowSize, contactsCount);
+                auto windowCount = windowEnd - windowBegin;
+                auto begin = windowBegin + windowCount * iThread / threadsCount;
+                auto end = windowBegin + windowCount * (iThread + 1) / threadsCount;
+                onShare(iThread, begin, end);
+
+                for (size_t iOwner = 0; iOwner < threadsCount; iOwner++)
+                    sent[iOwner].clear();
+                for (auto iContact = begin; iContact < end; iContact++)
+                {
+                    uint32_t row = iContact - windowBegin;
+                    sent[ownerOf(contacts.id1[iContact])].push_back(2 * row);
+                    int id2 = contacts.id2[iContact];
+                    if (id2 != ContactTable::wallId)
+                        sent[ownerOf(id2)].push_back(2 * row + 1);
+                }
+                sync();
+
+                for (size_t iSender = 0; iSender < threadsCount; iSender++)
+                {
+                    for (auto sentEnd : buckets[iSender * threadsCount + iThread])
+                        onEnd(windowBegin + sentEnd / 2, sentEnd % 2 == 1);
+                }
+                // Buckets are refilled in the next window.
+                sync();
+            } });
+    }
+}
+
+#endif // CONTACTTABLE_H
@@ -0,0 +1,177 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DUMPCOLUMNS_H
+#define DUMPCOLUMNS_H
+
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <stdexcept>
+#include <Eigen/Dense>
+#include "textCursor.h"
+
+namespace ForceChain
+{
+    // Particle properties this program reads from a liggghts dump.
+    enum class ParticleField
+    {
+        Skip,
+        Id,
+        Type,
+        X,
+        Y,
+        Z,
+        Radius
+    };
+
+    // A projection plan for a liggghts particle dump. It is built
+    // once from the column names of "ITEM: ATOMS id type x y z ... radius"
+    // header and tells which column fills which particle property.
+    // The other columns are skipped as bytes, without being parsed,
+    // and nothing after the last used column of a line is touched.
+    // So, the order and number of columns in a liggghts script can
+    // change freely as long as id, x, y, z and radius are dumped.
+    class ParticleColumns
+    {
+    public:
+        std::vector<ParticleField> fields;
+        size_t lastUsedColumn = 0;
+
+        // columnNames: the header line after "ITEM: ATOMS".
+        ParticleColumns(std::string_view columnNames)
+        {
+            TextCursor cursor(columnNames);
+            while (!cursor.AtEndOfLine())
+            {
+                auto name = cursor.ReadToken();
+                auto field = ParticleField::Skip;
+
+                if (name == "id")
+                    field = ParticleField::Id;
+                else if (name == "type")
+                    field = ParticleField::Type;
+                else if (name == "x")
+                    field = ParticleField::X;
+                else if (name == "y")
+                    field = ParticleField::Y;
+                else if (name == "z")
+                    field = ParticleField::Z;
+                else if (name == "radius")
+                    field = ParticleField::Radius;
+
+                if (field != ParticleField::Skip)
+                    lastUsedColumn = fields.size();
+                fields.push_back(field);
+            }
+
+            for (auto [field, name] : {std::pair{ParticleField::Id, "id"},
+                                       std::pair{ParticleField::X, "x"},
+                                       std::pair{ParticleField::Y, "y"},
+                                       std::pair{ParticleField::Z, "z"},
+                                       std::pair{ParticleField::Radius, "radius"}})
+            {
+                if (std::find(fields.begin(), fields.end(), field) == fields.end())
+                    throw std::runtime_error(std::string("\n Error: The particles dump has no column: ") + name +
+                                             "\n Columns are: " + std::string(columnNames));
+            }
+        }
+
+        // Reads the used columns of one particle line and moves the
+        // cursor to the next line. Returns false if a used column
+        // cannot be parsed.
+        template <typename Cursor>
+        bool ReadLine(Cursor &cursor, size_t &id, size_t &type,
+                      Eigen::Vector3d &position, double &radius) const
+        {
+            for (size_t column = 0; column <= lastUsedColumn; column++)
+            {
+                bool isRead = true;
+                switch (fields[column])
+                {
+                case ParticleField::Skip:
+                    cursor.SkipToken();
+                    break;
+                case ParticleField::Id:
+                    isRead = cursor.ReadInteger(id);
+                    break;
+                case ParticleField::Type:
+                    isRead = cursor.ReadInteger(type);
+                    break;
+                case ParticleField::X:
+                    isRead = cursor.ReadDouble(position(0));
+                    break;
+                case ParticleField::Y:
+                    isRead = cursor.ReadDouble(position(1));
+                    break;
+                case ParticleField::Z:
+                    isRead = cursor.ReadDouble(position(2));
+                    break;
+                case ParticleField::Radius:
+                    isRead = cursor.ReadDouble(radius);
+                    break;
+                }
+                if (!isRead)
+                    return false;
+            }
+            cursor.SkipLine();
+            return true;
+        }
+
+        // Same as ReadLine for a row of a binary dump, where every
+        // column is a double.
+        void ReadRow(const double *row, size_t &id, size_t &type,
+                     Eigen::Vector3d &position, double &radius) const
+        {
+            for (size_t column = 0; column <= lastUsedColumn; column++)
+            {
+                switch (fields[column])
+                {
+                case ParticleField::Skip:
+                    break;
+                case ParticleField::Id:
+                    id = row[column];
+                    break;
+                case ParticleField::Type:
+                    type = row[column];
+                    break;
+                case ParticleField::X:
+                    position(0) = row[column];
+                    break;
+                case ParticleField::Y:
+                    position(1) = row[column];
+                    break;
+                case ParticleField::Z:
+                    position(2) = row[column];
+                    break;
+                case ParticleField::Radius:
+                    radius = row[column];
+                    break;
+                }
+            }
+        }
+    };
+}
+
+#endif // DUMPCOLUMNS_H
@@ -0,0 +1,161 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DUMPFRAMES_H
+#define DUMPFRAMES_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "mappedFile.h"
+#include "textCursor.h"
+#include "compressedInput.h"
+#include "binaryDump.h"
+
+namespace ForceChain
+{
+    // Walks a liggghts dump file with many "ITEM: TIMESTEP" blocks,
+    // one frame at a time. Each frame is given as a text view that
+    // the frame readers accept, e.g. ReadParticlesFrame, ReadPairFrame.
+    // Frames already passed are released from memory, so a file much
+    // bigger than RAM can be walked.
+    // An index of timesteps and their byte offsets can be built for
+    // random access to frames, see BuildIndex and Seek.
+    // Frames are found by searching the mapped bytes, so compressed
+    // files and binary dumps are not accepted here.
+    class DumpFrames
+    {
+        MappedFile file;
+        std::string_view text;
+        // byte offset of the next frame
+        size_t offset = 0;
+        // byte offset where memory is not released yet
+        size_t releasedTo = 0;
+
+        // timestep, byte offset
+        std::vector<std::pair<size_t, size_t>> index;
+
+        static constexpr std::string_view frameLabel = "ITEM: TIMESTEP";
+        static constexpr std::string_view frameStart = "\nITEM: TIMESTEP";
+
+        // Returns the offset of the frame after the one starting at begin.
+        size_t FindFrameEnd(size_t begin) const
+        {
+            auto end = text.find(frameStart, begin);
+            return end == std::string_view::npos ? text.size() : end + 1;
+        }
+
+        static size_t ReadTimestep(std::string_view frame)
+        {
+            TextCursor cursor(frame);
+            cursor.SkipLine();
+            size_t timestep = 0;
+            cursor.ReadInteger(timestep);
+            return timestep;
+        }
+
+    public:
+        std::string fileName;
+
+        DumpFrames(std::string fileName_) : file(fileName_), text(file.View()), fileName(fileName_)
+        {
+            if (IsCompressed(fileName))
+                throw std::runtime_error("\n Error: Frames of a compressed file cannot be walked, decompress it first:\n" + fileName);
+            if (IsBinaryDump(fileName))
+                throw std::runtime_error("\n Error: Frames of a binary dump cannot be walked here, read them by BinaryDumpFile:\n" + fileName);
+
+            offset = text.find(frameLabel);
+            if (offset == std::string_view::npos)
+                offset = text.size();
+        }
+
+        DumpFrames(const DumpFrames &) = delete;
+        DumpFrames &operator=(const DumpFrames &) = delete;
+
+        // Gives the next frame and its timestep. Returns false at the
+        // end of file. The previous frames are released from memory,
+        // so frame views given before must not be used anymore.
+        bool Next(std::string_view &frame, size_t &timestep)
+        {
+            if (offset >= text.size())
+                return false;
+
+            auto end = FindFrameEnd(offset);
+            frame = text.substr(offset, end - offset);
+            timestep = ReadTimestep(frame);
+
+            file.Release(releasedTo, offset);
+            releasedTo = offset;
+            offset = end;
+            return true;
+        }
+
+        // Scans the file once for "ITEM: TIMESTEP" lines and records
+        // timesteps and their byte offsets. Only the labels are searched,
+        // frames are not parsed.
+        const auto &BuildIndex()
+        {
+            index.clear();
+            auto begin = text.find(frameLabel);
+            while (begin != std::string_view::npos && begin < text.size())
+            {
+                auto end = FindFrameEnd(begin);
+                index.emplace_back(ReadTimestep(text.substr(begin, end - begin)), begin);
+                file.Release(begin, end);
+                begin = end;
+            }
+            return index;
+        }
+
+        const auto &GetIndex() const
+        {
+            return index;
+        }
+
+        // Moves to the frame of timestep, so Next gives it. BuildIndex
+        // must be called first. Returns false if timestep is not found.
+        bool Seek(size_t timestep)
+        {
+            auto it = std::find_if(index.begin(), index.end(),
+                                   [timestep](auto &item)
+                                   { return item.first == timestep; });
+            if (it == index.end())
+                return false;
+            offset = it->second;
+            releasedTo = offset;
+            return true;
+        }
+
+        // Moves back to the first frame.
+        void Rewind()
+        {
+            offset = text.find(frameLabel);
+            if (offset == std::string_view::npos)
+                offset = text.size();
+            releasedTo = offset;
+        }
+    };
+}
+
+#endif // DUMPFRAMES_H
@@ -23,27 +23,95 @@
 #ifndef FILTER_H
 #define FILTER_H
 
+#include <vector>
+#include <cmath>
 #include "particle.h"
 
 namespace ForceChain
 {
-    class Filter
+    // Fields that filters test of the particles of chains, one vector
+    // each, so filter expressions read them at memory speed, see
+    // FilterExpression. Rows are the particles of the chains one after
+    // another, the rows of chain k are chainOffsets[k] to
+    // chainOffsets[k + 1]. Filters that have no IsInside of columns
+    // are given the particle of a row, particles[particleIds[i]].
+    template <typename Scalar>
+    struct BasicFilterColumns
+    {
+        std::vector<Scalar> x, y, z;
+        std::vector<Scalar> minorStress;
+        std::vector<size_t> particleIds;
+        std::vector<size_t> chainOffsets{0};
+        const BasicParticles<Scalar> *particles = nullptr;
+
+        void Set(const BasicParticles<Scalar> &particles_,
+                 const std::vector<std::vector<size_t>> &chains)
+        {
+            particles = &particles_;
+            particleIds.clear();
+            chainOffsets.assign(1, 0);
+            for (auto &chain : chains)
+            {
+                particleIds.insert(particleIds.end(), chain.begin(), chain.end());
+                chainOffsets.push_back(particleIds.size());
+            }
+
+            auto count = particleIds.size();
+            x.resize(count);
+            y.resize(count);
+            z.resize(count);
+            minorStress.resize(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                auto particle = particles_[particleIds[i]];
+                x[i] = particle.position(0);
+                y[i] = particle.position(1);
+                z[i] = particle.position(2);
+                minorStress[i] = particle.minorStress;
+            }
+        }
+
+        auto Size() const
+        {
+            return x.size();
+        }
+    };
+
+    // Filters of BasicParticle<Scalar>. Filter and the other names
+    // without Basic are the ones of Particle.
+    template <typename Scalar>
+    class BasicFilter
     {
     public:
-        virtual bool IsInside(const Particle &particle) = 0;
+        virtual bool IsInside(const BasicParticle<Scalar> &particle) = 0;
     };
 
-    class MinorStressGreaterFilter : public Filter
+    template <typename Scalar>
+    class BasicMinorStressGreaterFilter : public BasicFilter<Scalar>
     {
         double minMinorStress;
 
     public:
-        MinorStressGreaterFilter(double minMinorStress_) : minMinorStress(minMinorStress_) {}
-        bool IsInside(const Particle &particle) override
+        BasicMinorStressGreaterFilter(double minMinorStress_) : minMinorStress(minMinorStress_) {}
+        bool IsInside(const BasicParticle<Scalar> &particle) override
+        {
+            return IsInsideStress(particle.minorStress);
+        }
+
+        // IsInside of particle i of columns, see FilterExpression.
+        bool IsInside(const BasicFilterColumns<Scalar> &columns, size_t i) const
         {
-            return std::abs(particle.minorStress) >= std::abs(minMinorStress);
+            return IsInsideStress(columns.minorStress[i]);
+        }
+
+        bool IsInsideStress(Scalar minorStress) const
+        {
+            return std::abs(minorStress) >= std::abs(minMinorStress);
         }
     };
+
+    using Filter = BasicFilter<double>;
+    using MinorStressGreaterFilter = BasicMinorStressGreaterFilter<double>;
 }
 
 #endif //FILTER_H
\ No newline at end of file
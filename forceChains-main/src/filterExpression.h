@@ -0,0 +1,368 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FILTEREXPRESSION_H
+#define FILTEREXPRESSION_H
+
+#include <vector>
+#include <cstdint>
+#include <bit>
+#include <algorithm>
+#include <type_traits>
+#include "filter.h"
+
+namespace ForceChain
+{
+    // Bits of particles or chains, 64 in a word, e.g. the ones
+    // accepted by a filter expression.
+    class FilterBits
+    {
+        // Clears the bits past count in the last word.
+        void ClearTail()
+        {
+            if (count % 64)
+                words.back() &= (uint64_t(1) << (count % 64)) - 1;
+        }
+
+    public:
+        std::vector<uint64_t> words;
+        size_t count = 0;
+
+        void Assign(size_t count_, bool value)
+        {
+            count = count_;
+            words.assign((count + 63) / 64, value ? ~uint64_t(0) : 0);
+            ClearTail();
+        }
+
+        bool Get(size_t i) const
+        {
+            return (words[i / 64] >> (i % 64)) & 1;
+        }
+
+        void Set(size_t i)
+        {
+            words[i / 64] |= uint64_t(1) << (i % 64);
+        }
+
+        auto &operator&=(const FilterBits &other)
+        {
+            for (size_t k = 0; k < words.size(); k++)
+                words[k] &= other.words[k];
+            return *this;
+        }
+
+        auto &operator|=(const FilterBits &other)
+        {
+            for (size_t k = 0; k < words.size(); k++)
+                words[k] |= other.words[k];
+            return *this;
+        }
+
+        void Flip()
+        {
+            for (auto &word : words)
+                word = ~word;
+            ClearTail();
+        }
+
+        // Whether any bit of first to last is set.
+        bool IsAnySet(size_t first, size_t last) const
+        {
+            while (first < last)
+            {
+                auto shift = first % 64;
+                auto length = std::min<size_t>(64 - shift, last - first);
+                auto mask = (length == 64 ? ~uint64_t(0) : (uint64_t(1) << length) - 1) << shift;
+                if (words[first / 64] & mask)
+                    return true;
+                first += length;
+            }
+            return false;
+        }
+
+        // Whether all bits of first to last are set.
+        bool AreAllSet(size_t first, size_t last) const
+        {
+            while (first < last)
+            {
+                auto shift = first % 64;
+                auto length = std::min<size_t>(64 - shift, last - first);
+                auto mask = (length == 64 ? ~uint64_t(0) : (uint64_t(1) << length) - 1) << shift;
+                if ((words[first / 64] & mask) != mask)
+                    return false;
+                first += length;
+            }
+            return true;
+        }
+
+        // Number of set bits.
+        size_t Count() const
+        {
+            size_t setCount = 0;
+            for (auto word : words)
+                setCount += std::popcount(word);
+            return setCount;
+        }
+    };
+
+    /*
+    Filter expressions combine the filters of filter.h and
+    sectionFilter.h, or any other BasicFilter, e.g.
+
+        auto expression = AllOf(boxFilter) && !AnyOf(Where(sphereFilter) && Where(stressFilter));
+        stat.ApplyFilter(expression);
+
+    Where(filter) accepts the particles filter accepts, and &&, || and
+    ! of them are of particles. AllOf and AnyOf accept chains whose
+    particles all, or any, are accepted by an expression of particles,
+    and &&, || and ! of them are of chains.
+
+    An expression is a type made of the filters, copied in it, so it is
+    compiled to one inlined test of a particle, without virtual calls.
+    Filters read the fields of particles from BasicFilterColumns, those
+    with no IsInside of columns are called on the particle. Particles
+    of chains are tested in order into FilterBits, a chain is tested
+    on the words of its bits, and chain expressions combine words of
+    bits of chains.
+    */
+
+    // Bases of the expressions of particles and of chains.
+    struct ParticleExpression
+    {
+    };
+    struct ChainExpression
+    {
+    };
+
+    template <typename T>
+    concept IsParticleExpression = std::is_base_of_v<ParticleExpression, T>;
+    template <typename T>
+    concept IsChainExpression = std::is_base_of_v<ChainExpression, T>;
+
+    // Particles filter accepts.
+    template <typename Filter>
+    struct FilterWhere : ParticleExpression
+    {
+        // IsInside of particles is not const.
+        mutable Filter filter;
+
+        template <typename Scalar>
+        bool operator()(const BasicFilterColumns<Scalar> &columns, size_t i) const
+        {
+            if constexpr (requires { filter.IsInside(columns, i); })
+                return filter.IsInside(columns, i);
+            else
+                return filter.IsInside((*columns.particles)[columns.particleIds[i]]);
+        }
+    };
+
+    // Both sides are tested, so a test has no branch.
+    template <typename A, typename B>
+    struct FilterAnd : ParticleExpression
+    {
+        A a;
+        B b;
+
+        template <typename Scalar>
+        bool operator()(const BasicFilterColumns<Scalar> &columns, size_t i) const
+        {
+            return a(columns, i) & b(columns, i);
+        }
+    };
+
+    template <typename A, typename B>
+    struct FilterOr : ParticleExpression
+    {
+        A a;
+        B b;
+
+        template <typename Scalar>
+        bool operator()(const BasicFilterColumns<Scalar> &columns, size_t i) const
+        {
+            return a(columns, i) | b(columns, i);
+        }
+    };
+
+    template <typename A>
+    struct FilterNot : ParticleExpression
+    {
+        A a;
+
+        template <typename Scalar>
+        bool operator()(const BasicFilterColumns<Scalar> &columns, size_t i) const
+        {
+            return !a(columns, i);
+        }
+    };
+
+    // Sets bits of the rows of columns that expression accepts.
+    template <typename Expression, typename Scalar>
+    void SelectParticles(const Expression &expression, const BasicFilterColumns<Scalar> &columns, FilterBits &bits)
+    {
+        auto count = columns.Size();
+        bits.Assign(count, false);
+        for (size_t k = 0; k < bits.words.size(); k++)
+        {
+            uint64_t word = 0;
+            auto first = 64 * k;
+            auto last = std::min(first + 64, count);
+            for (auto i = first; i < last; i++)
+                word |= uint64_t(expression(columns, i)) << (i - first);
+            bits.words[k] = word;
+        }
+    }
+
+    // Chains whose particles all, if isAll, or any are accepted by an
+    // expression of particles.
+    template <typename Expression, bool isAll>
+    struct FilterChainsOf : ChainExpression
+    {
+        Expression expression;
+
+        template <typename Scalar>
+        void Select(const BasicFilterColumns<Scalar> &columns, FilterBits &bits) const
+        {
+            FilterBits particleBits;
+            SelectParticles(expression, columns, particleBits);
+
+            auto &offsets = columns.chainOffsets;
+            bits.Assign(offsets.size() - 1, false);
+            for (size_t chainId = 0; chainId + 1 < offsets.size(); chainId++)
+            {
+                bool isAccepted = isAll ? particleBits.AreAllSet(offsets[chainId], offsets[chainId + 1])
+                                        : particleBits.IsAnySet(offsets[chainId], offsets[chainId + 1]);
+                if (isAccepted)
+                    bits.Set(chainId);
+            }
+        }
+    };
+
+    template <typename A, typename B>
+    struct ChainAnd : ChainExpression
+    {
+        A a;
+        B b;
+
+        template <typename Scalar>
+        void Select(const BasicFilterColumns<Scalar> &columns, FilterBits &bits) const
+        {
+            FilterBits bBits;
+            a.Select(columns, bits);
+            b.Select(columns, bBits);
+            bits &= bBits;
+        }
+    };
+
+    template <typename A, typename B>
+    struct ChainOr : ChainExpression
+    {
+        A a;
+        B b;
+
+        template <typename Scalar>
+        void Select(const BasicFilterColumns<Scalar> &columns, FilterBits &bits) const
+        {
+            FilterBits bBits;
+            a.Select(columns, bits);
+            b.Select(columns, bBits);
+            bits |= bBits;
+        }
+    };
+
+    template <typename A>
+    struct ChainNot : ChainExpression
+    {
+        A a;
+
+        template <typename Scalar>
+        void Select(const BasicFilterColumns<Scalar> &columns, FilterBits &bits) const
+        {
+            a.Select(columns, bits);
+            bits.Flip();
+        }
+    };
+
+    template <typename Filter>
+    auto Where(const Filter &filter)
+    {
+        return FilterWhere<Filter>{{}, filter};
+    }
+
+    // AllOf and AnyOf take an expression of particles or a filter.
+    template <typename Expression>
+    auto AllOf(const Expression &expression)
+    {
+        if constexpr (IsParticleExpression<Expression>)
+            return FilterChainsOf<Expression, true>{{}, expression};
+        else
+            return AllOf(Where(expression));
+    }
+
+    template <typename Expression>
+    auto AnyOf(const Expression &expression)
+    {
+        if constexpr (IsParticleExpression<Expression>)
+            return FilterChainsOf<Expression, false>{{}, expression};
+        else
+            return AnyOf(Where(expression));
+    }
+
+    template <IsParticleExpression A, IsParticleExpression B>
+    auto operator&&(const A &a, const B &b)
+    {
+        return FilterAnd<A, B>{{}, a, b};
+    }
+
+    template <IsParticleExpression A, IsParticleExpression B>
+    auto operator||(const A &a, const B &b)
+    {
+        return FilterOr<A, B>{{}, a, b};
+    }
+
+    template <IsParticleExpression A>
+    auto operator!(const A &a)
+    {
+        return FilterNot<A>{{}, a};
+    }
+
+    template <IsChainExpression A, IsChainExpression B>
+    auto operator&&(const A &a, const B &b)
+    {
+        return ChainAnd<A, B>{{}, a, b};
+    }
+
+    template <IsChainExpression A, IsChainExpression B>
+    auto operator||(const A &a, const B &b)
+    {
+        return ChainOr<A, B>{{}, a, b};
+    }
+
+    template <IsChainExpression A>
+    auto operator!(const A &a)
+    {
+        return ChainNot<A>{{}, a};
+    }
+}
+
+#endif // FILTEREXPRESSION_H
@@ -0,0 +1,105 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef INCREMENTALCHAINS_H
+#define INCREMENTALCHAINS_H
+
+#include <vector>
+#include <cstdint>
+#include <Eigen/Dense>
+#include "particle.h"
+#include "contactGraph.h"
+
+namespace ForceChain
+{
+    // Keeps the chain search of a frame for the next one, see
+    // BasicChainFinder::incrementalChains.
+    //
+    // A particle has changed if whether it has minor stress, its
+    // minorDir, position, radius or contacts changed. Angle checks
+    // are done again only for the edges of particles that changed or
+    // touch one that did. A component, of particles joined by eligible
+    // edges, is searched again only if it holds such a particle. The
+    // others have the same edges and flags as in the last frame, so
+    // they take its chains, minorDir flips and links as they are, and
+    // chains are the same as those of a full search.
+    //
+    // The whole frame is searched if particles or their ids, alpha or
+    // the box changed, if a particle is in a chain before the search,
+    // or if edge cosines are given.
+    template <typename Scalar>
+    class BasicIncrementalChains
+    {
+        template <typename>
+        friend class BasicChainFinder;
+
+        using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
+
+        // Inputs of the last search.
+        bool hasFrame = false;
+        double alpha = 0;
+        std::vector<std::vector<double>> box;
+        std::vector<size_t> ids;
+        std::vector<Vector3> positions;
+        std::vector<Vector3> minorDirs;
+        std::vector<Scalar> radii;
+        std::vector<uint8_t> hasMinorStress;
+        ContactGraph graph;
+
+        // What it found, chainIds are of nodes and dirSigns the
+        // flips of minorDir.
+        std::vector<uint8_t> edgeFlags;
+        std::vector<std::vector<size_t>> chains;
+        std::vector<mint> chainIds;
+        std::vector<int8_t> dirSigns;
+        ChainLinks links;
+
+        size_t searchedCount = 0;
+
+    public:
+        // If true, every search is also done in full on a copy of the
+        // particles, and an error is thrown if the two differ in
+        // chains, chainIds, minorDir or links. It is for tests, as it
+        // costs more than a full search.
+        bool isChecked;
+
+        BasicIncrementalChains(bool isChecked_ = false) : isChecked(isChecked_) {}
+
+        // Forgets the last frame, the next one is searched in full.
+        void Reset()
+        {
+            hasFrame = false;
+        }
+
+        // Particles with minor stress in the components searched in the
+        // last frame.
+        auto GetSearchedCount() const
+        {
+            return searchedCount;
+        }
+    };
+
+    using IncrementalChains = BasicIncrementalChains<double>;
+}
+
+#endif // INCREMENTALCHAINS_H
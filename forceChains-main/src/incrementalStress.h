@@ -0,0 +1,311 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCREMENTALSTRESS_H
+#define INCREMENTALSTRESS_H
+
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+#include <Eigen/Dense>
+#include "particle.h"
+#include "contactTable.h"
+#include "contactStress.h"
+
+namespace ForceChain
+{
+    // Carries stresses from one frame to the next one. Pair contacts
+    // of a frame are matched with those of the previous frame by their
+    // (id1, id2), and only the removed, added and changed contacts
+    // are subtracted from or added to the previous stresses. Wall
+    // contacts are few and are summed again every frame.
+    //
+    // A particle needs its principle stresses solved again only if its
+    // stress moved more than tolerance, relative to the stress they
+    // were last solved for. The others keep their previous principle
+    // stresses and directions. With tolerance = 0 every particle whose
+    // stress changed is solved again.
+    //
+    // Sums of many updates drift by round off, so stresses are summed
+    // from scratch every refreshInterval frames, and whenever the
+    // particles or their radii change or a pair repeats in a frame.
+    // The pair sums are carried between frames in double, for
+    // particles of any Scalar.
+    template <typename Scalar>
+    class BasicIncrementalStress
+    {
+        using Particle = BasicParticle<Scalar>;
+
+        // Principle stresses of one particle, as left by the solver.
+        struct PrincipleState
+        {
+            typename Particle::Matrix3c principleDirs;
+            typename Particle::Vector3c principleStresses;
+            bool arePrincipleStressesSolved;
+            bool hasMinorStress;
+            Scalar minorStress;
+            typename Particle::Vector3 minorDir;
+        };
+
+        // Pair contacts of the previous frame sorted by key.
+        ContactTable previousContacts;
+        std::vector<uint64_t> previousKeys;
+
+        std::vector<size_t> ids;
+        std::vector<Scalar> radii;
+        std::vector<Eigen::Matrix3d> pairStresses;
+        std::vector<Eigen::Vector3d> pairForces;
+        std::vector<bool> hadWall;
+
+        // Stress each particle was solved for last time.
+        std::vector<typename Particle::Matrix3> solvedStresses;
+        std::vector<PrincipleState> states;
+        std::vector<size_t> solvedIds;
+
+        size_t framesSinceRefresh = 0;
+
+        static uint64_t Key(int id1, int id2)
+        {
+            return (uint64_t(uint32_t(id1)) << 32) | uint32_t(id2);
+        }
+
+        static bool IsSameContact(const ContactTable &a, size_t ia, const ContactTable &b, size_t ib)
+        {
+            for (size_t i = 0; i < 3; i++)
+            {
+                if (a.f12[i][ia] != b.f12[i][ib] || a.x12[i][ia] != b.x12[i][ib])
+                    return false;
+            }
+            return a.overlap[ia] == b.overlap[ib];
+        }
+
+        // Adds sign times stress and force of contacts to pair stresses
+        // and forces.
+        void AddToPairs(const BasicParticles<Scalar> &particles, const ContactTable &contacts,
+                        double sign, std::vector<bool> &isTouched)
+        {
+            auto count = contacts.Size();
+            ContactStresses first(count, 9), second(count, 9);
+            ComputeContactStresses(particles, contacts, 0, count, first, second, 0);
+
+            for (size_t iContact = 0; iContact < count; iContact++)
+            {
+                size_t id1 = contacts.id1[iContact];
+                size_t id2 = contacts.id2[iContact];
+                isTouched[id1] = isTouched[id2] = true;
+                for (size_t i = 0; i < 3; i++)
+                {
+                    pairForces[id1](i) += sign * contacts.f12[i][iContact];
+                    pairForces[id2](i) -= sign * contacts.f12[i][iContact];
+                    for (size_t j = 0; j < 3; j++)
+                    {
+                        pairStresses[id1](i, j) += sign * first(iContact, 3 * i + j);
+                        pairStresses[id2](i, j) += sign * second(iContact, 3 * i + j);
+                    }
+                }
+            }
+        }
+
+        // Sums stresses from scratch, every particle is solved again.
+        void Refresh(BasicParticles<Scalar> &particles, const ContactTable &contacts,
+                     const ContactTable &wallContacts, size_t threadsCount)
+        {
+            ResetStressAndForce(particles);
+            AddContacts(particles, contacts, threadsCount);
+
+            auto particlesCount = particles.size();
+            ids.resize(particlesCount);
+            radii.resize(particlesCount);
+            pairStresses.resize(particlesCount);
+            pairForces.resize(particlesCount);
+            for (size_t i = 0; i < particlesCount; i++)
+            {
+                ids[i] = particles[i].id;
+                radii[i] = particles[i].radius;
+                pairStresses[i] = particles[i].stress.template cast<double>();
+                pairForces[i] = particles[i].force.template cast<double>();
+            }
+
+            AddContacts(particles, wallContacts, threadsCount);
+
+            solvedIds.resize(particlesCount);
+            std::iota(solvedIds.begin(), solvedIds.end(), 0);
+            framesSinceRefresh = 0;
+        }
+
+    public:
+        double tolerance;
+        size_t refreshInterval;
+
+        BasicIncrementalStress(double tolerance_ = 0, size_t refreshInterval_ = 20)
+            : tolerance(tolerance_), refreshInterval(refreshInterval_) {}
+
+        // Forgets the previous frame, the next one is summed from scratch.
+        void Reset()
+        {
+            previousContacts.Clear();
+            previousKeys.clear();
+            ids.clear();
+            radii.clear();
+            states.clear();
+        }
+
+        // Sets force and stress of particles of a new frame
+        // from its contacts and the previous frame, and gives particles
+        // that need no new solve their previous principle stresses.
+        // Returns ids of particles whose principle stresses must be
+        // solved; after solving them call Remember.
+        const std::vector<size_t> &Update(BasicParticles<Scalar> &particles, const ContactTable &contacts,
+                                          const ContactTable &wallContacts, size_t threadsCount = 1)
+        {
+            auto particlesCount = particles.size();
+            auto contactsCount = contacts.Size();
+
+            std::vector<uint64_t> keys(contactsCount);
+            std::vector<size_t> order(contactsCount);
+            for (size_t i = 0; i < contactsCount; i++)
+                keys[i] = Key(contacts.id1[i], contacts.id2[i]);
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                      { return keys[a] < keys[b]; });
+
+            bool hasRepeatedPair = false;
+            for (size_t i = 1; i < contactsCount; i++)
+                hasRepeatedPair = hasRepeatedPair || keys[order[i]] == keys[order[i - 1]];
+
+            bool isSameParticles = radii.size() == particlesCount && states.size() == particlesCount;
+            for (size_t i = 0; isSameParticles && i < particlesCount; i++)
+                isSameParticles = ids[i] == particles[i].id && radii[i] == particles[i].radius;
+
+            framesSinceRefresh++;
+            if (!isSameParticles || hasRepeatedPair || framesSinceRefresh >= refreshInterval)
+                Refresh(particles, contacts, wallContacts, threadsCount);
+            else
+            {
+                // Merge of the sorted keys of both frames.
+                ContactTable removed, added;
+                size_t iPrevious = 0, iNew = 0;
+                while (iPrevious < previousKeys.size() || iNew < contactsCount)
+                {
+                    auto newKey = iNew < contactsCount ? keys[order[iNew]] : UINT64_MAX;
+                    auto previousKey = iPrevious < previousKeys.size() ? previousKeys[iPrevious] : UINT64_MAX;
+                    if (iNew < contactsCount && (iPrevious == previousKeys.size() || newKey < previousKey))
+                        added.Add(contacts.Get(order[iNew++]));
+                    else if (iNew == contactsCount || previousKey < newKey)
+                        removed.Add(previousContacts.Get(iPrevious++));
+                    else
+                    {
+                        if (!IsSameContact(previousContacts, iPrevious, contacts, order[iNew]))
+                        {
+                            removed.Add(previousContacts.Get(iPrevious));
+                            added.Add(contacts.Get(order[iNew]));
+                        }
+                        iPrevious++;
+                        iNew++;
+                    }
+                }
+
+                std::vector<bool> isTouched(particlesCount, false);
+                AddToPairs(particles, removed, -1., isTouched);
+                AddToPairs(particles, added, +1., isTouched);
+
+                // Wall contacts of this and the previous frame.
+                for (size_t i = 0; i < wallContacts.Size(); i++)
+                    isTouched[wallContacts.id1[i]] = true;
+                for (size_t i = 0; i < hadWall.size(); i++)
+                    isTouched[i] = isTouched[i] || hadWall[i];
+
+                for (size_t i = 0; i < particlesCount; i++)
+                {
+                    particles[i].stress = pairStresses[i].template cast<Scalar>();
+                    particles[i].force = pairForces[i].template cast<Scalar>();
+                }
+                AddContacts(particles, wallContacts, threadsCount);
+
+                solvedIds.clear();
+                for (size_t i = 0; i < particlesCount; i++)
+                {
+                    auto particle = particles[i];
+                    bool isMoved = isTouched[i] &&
+                                   (particle.stress - solvedStresses[i]).norm() > tolerance * solvedStresses[i].norm();
+                    if (isMoved)
+                    {
+                        solvedIds.push_back(i);
+                        continue;
+                    }
+
+                    auto &state = states[i];
+                    particle.principleDirs = state.principleDirs;
+                    particle.principleStresses = state.principleStresses;
+                    particle.arePrincipleStressesSolved = state.arePrincipleStressesSolved;
+                    particle.hasMinorStress = state.hasMinorStress;
+                    particle.minorStress = state.minorStress;
+                    particle.minorDir = state.minorDir;
+                }
+            }
+
+            previousContacts.Clear();
+            previousContacts.Reserve(contactsCount);
+            previousKeys.resize(contactsCount);
+            for (size_t i = 0; i < contactsCount; i++)
+            {
+                previousContacts.Add(contacts.Get(order[i]));
+                previousKeys[i] = keys[order[i]];
+            }
+
+            hadWall.assign(particlesCount, false);
+            for (size_t i = 0; i < wallContacts.Size(); i++)
+                hadWall[wallContacts.id1[i]] = true;
+
+            return solvedIds;
+        }
+
+        // Keeps the principle stresses of particles, after the ones
+        // given by Update are solved, for the next frame. Call it
+        // before chains are found, as that flips minor directions.
+        void Remember(const BasicParticles<Scalar> &particles)
+        {
+            // The others still have their remembered state.
+            states.resize(particles.size());
+            solvedStresses.resize(particles.size());
+            for (auto i : solvedIds)
+            {
+                auto particle = particles[i];
+                solvedStresses[i] = particle.stress;
+                states[i] = {particle.principleDirs, particle.principleStresses,
+                             particle.arePrincipleStressesSolved, particle.hasMinorStress,
+                             particle.minorStress, particle.minorDir};
+            }
+        }
+
+        // Number of particles solved in the last frame.
+        auto GetSolvedCount() const
+        {
+            return solvedIds.size();
+        }
+    };
+
+    using IncrementalStress = BasicIncrementalStress<double>;
+}
+
+#endif // INCREMENTALSTRESS_H
@@ -20,78 +20,358 @@
 # along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifndef LIGGGHTSREADER_H
+#define LIGGGHTSREADER_H
+
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <string>
 #include <cmath>
+#include <chrono>
 #include <exception>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
 
 #include "particle.h"
 #include "periodicCorrection.h"
+#include "mappedFile.h"
+#include "textCursor.h"
+#include "dumpColumns.h"
+#include "compressedInput.h"
+#include "binaryDump.h"
+#include "contactTable.h"
+#include "contactStress.h"
+#include "particleIdMap.h"
 
 namespace ForceChain
 {
-    // Reads Particles individual properties: x,y,z,radius
-    // from a liggghts CSV file and store them.
-    // Returns a vector of this particles.
-    // Note: Particles[0] is empty as liggghts index start
-    // from 1.
-    auto ReadParticles(std::string fileName)
+    // Header of one liggghts dump frame.
+    struct DumpHeader
     {
+        size_t timestep = 0;
+        // Number of atoms or entries
+        size_t count = 0;
+        std::vector<double> low_bound = std::vector<double>(3);
+        std::vector<double> upp_bound = std::vector<double>(3);
+        // Column names after "ITEM: ATOMS" or "ITEM: ENTRIES"
+        std::string columnNames;
+        bool hasColumns = false;
+    };
+
+    // Reads a liggghts frame header by its ITEM labels, not line
+    // numbers. The cursor stops at the first data line, after the
+    // "ITEM: ATOMS ..." or "ITEM: ENTRIES ..." line.
+    // iLine counts the lines read.
+    // Cursor is a TextCursor or a ChunkCursor for compressed inputs.
+    template <typename Cursor>
+    auto ReadDumpHeader(Cursor &cursor, size_t &iLine)
+    {
+        DumpHeader header;
+        while (!cursor.AtEnd())
+        {
+            iLine++;
+            auto line = cursor.ReadLine();
+            if (line.starts_with("ITEM: TIMESTEP"))
+            {
+                iLine++;
+                cursor.ReadInteger(header.timestep);
+                cursor.SkipLine();
+            }
+            else if (line.starts_with("ITEM: NUMBER OF"))
+            {
+                iLine++;
+                cursor.ReadInteger(header.count);
+                cursor.SkipLine();
+            }
+            else if (line.starts_with("ITEM: BOX BOUNDS"))
+            {
+                for (size_t dim = 0; dim < 3; dim++)
+                {
+                    iLine++;
+                    cursor.ReadDouble(header.low_bound[dim]);
+                    cursor.ReadDouble(header.upp_bound[dim]);
+                    cursor.SkipLine();
+                }
+            }
+            else if (line.starts_with("ITEM: ATOMS") || line.starts_with("ITEM: ENTRIES"))
+            {
+                header.columnNames = std::string(line.substr(line.find(' ', 6) + 1));
+                header.hasColumns = true;
+                break;
+            }
+        }
+        return header;
+    }
 
-        std::vector<Particle> particles;
-
-        std::ifstream fileStream(fileName);
+    // Orders particles by id, as chains are searched in the order of
+    // particles. A repeated id is an error.
+    template <typename Scalar>
+    void SortParticlesById(BasicParticles<Scalar> &particles, const std::string &source)
+    {
+        auto isLess = [](const BasicParticle<Scalar> &a, const BasicParticle<Scalar> &b)
+        { return a.id < b.id; };
+        if (!std::is_sorted(particles.begin(), particles.end(), isLess))
+        {
+            // (id, index), sorting them moves no particle.
+            std::vector<std::pair<size_t, size_t>> order(particles.size());
+            for (size_t i = 0; i < particles.size(); i++)
+                order[i] = {particles[i].id, i};
+            std::sort(order.begin(), order.end());
+
+            BasicParticles<Scalar> sorted;
+            sorted.reserve(particles.size());
+            for (auto &item : order)
+            {
+                sorted.hot.push_back(particles.hot[item.second]);
+                sorted.cold.push_back(particles.cold[item.second]);
+                sorted.principles.push_back(particles.principles[item.second]);
+            }
+            particles = std::move(sorted);
+        }
 
-        if(fileStream.fail()){
-            throw std::runtime_error("\n Error: The below file does not exist:\n"+fileName);
+        for (size_t i = 1; i < particles.size(); i++)
+        {
+            if (particles[i].id == particles[i - 1].id)
+                throw std::runtime_error("\n Error: The particle id " + std::to_string(particles[i].id) +
+                                         " is repeated in the below input:\n" + source);
         }
+    }
 
-        size_t particlesCount = 0;
-        size_t iLine = 0;
-        std::string line;
-        while (getline(fileStream, line))
+    // Calls onRow(id, type, position, radius) for every particle line
+    // of a frame whose header is read, in the order of the input. The
+    // columns are found from "ITEM: ATOMS" line, see ParticleColumns.
+    // The cursor is left at the start of the next frame.
+    template <typename Cursor, typename OnRow>
+    void ReadParticleRows(Cursor &cursor, const std::string &source, const DumpHeader &header,
+                          size_t &iLine, OnRow onRow)
+    {
+        if (!header.hasColumns)
+            throw std::runtime_error("\n Error: No \"ITEM: ATOMS\" header in the below input:\n" + source);
+
+        ParticleColumns columns(header.columnNames);
+
+        while (!cursor.AtEnd() && !cursor.StartsWith("ITEM:"))
         {
             iLine++;
-            if (iLine == 4)
+            if (cursor.AtEndOfLine())
             {
-                std::stringstream str(line);
-                str >> particlesCount;
-                particles.resize(particlesCount + 1);
-            }
-            // skip file headers
-            if (iLine < 10)
+                cursor.SkipLine();
                 continue;
+            }
 
-            std::stringstream str(line);
-
-            size_t id;
-            str >> id;
-            if (id > particles.size() - 1)
-                std::cout << "The id of a particle cannot be bigger than number of particles!";
+            size_t id = 0, type = 0;
+            double radius;
+            Eigen::Vector3d position;
+            if (!columns.ReadLine(cursor, id, type, position, radius))
+                throw std::runtime_error("\n Error: Cannot read line " + std::to_string(iLine) +
+                                         " of the below input:\n" + source);
 
-            particles[id].id = id;
+            onRow(id, type, position, radius);
+        }
+    }
 
-            str >> particles[id].type;
-            str >> particles[id].position(0) >> particles[id].position(1) >> particles[id].position(2);
+    // Reads the particles of one liggghts dump frame: id, type, x, y,
+    // z, radius. The cursor is at the frame start and is left at the
+    // start of the next frame. source names the input in error messages.
+    // Other columns of the dump are skipped, see ReadParticleRows.
+    // Particles are ordered by id and are as many as in the frame,
+    // ids may have gaps, see ParticleIdMap.
+    template <typename Scalar = double, typename Cursor>
+    auto ReadParticlesFrame(Cursor &cursor, const std::string &source)
+    {
+        BasicParticles<Scalar> particles;
 
-            // skip unused particle properties
-            double tmp;
-            for (size_t i = 0; i < 12; i++)
-                str >> tmp;
+        size_t iLine = 0;
+        auto header = ReadDumpHeader(cursor, iLine);
+        particles.reserve(header.count);
+
+        ReadParticleRows(cursor, source, header, iLine, [&](size_t id, size_t type, const Eigen::Vector3d &position, double radius)
+                         {
+            auto particle = particles.emplace_back();
+            particle.id = id;
+            particle.type = type;
+            particle.position = position.template cast<Scalar>();
+            particle.radius = radius; });
+
+        SortParticlesById(particles, source);
+        return particles;
+    }
 
-            str >> particles[id].radius;
+    // Column names of the particle dumps in liggghtsResult. Binary
+    // dumps of older LIGGGHTS/LAMMPS have no column names, so these are
+    // assumed for them unless others are given.
+    const std::string defaultParticleColumns =
+        "id type x y z ix iy iz vx vy vz fx fy fz omegax omegay omegaz radius";
+
+    // Same as ReadParticleRows for a frame of a binary dump.
+    // columnNames is used if the frame has no column names.
+    template <typename OnRow>
+    void ReadParticleBinaryRows(const BinaryDumpFrame &frame, const std::string &source, OnRow onRow,
+                                const std::string &columnNames = defaultParticleColumns)
+    {
+        ParticleColumns columns(frame.columnNames.empty() ? columnNames : frame.columnNames);
+        if (columns.fields.size() != frame.columnsCount)
+            throw std::runtime_error("\n Error: The below binary dump has " + std::to_string(frame.columnsCount) +
+                                     " columns, but " + std::to_string(columns.fields.size()) +
+                                     " column names are given:\n" + source);
 
+        for (size_t iRow = 0; iRow < frame.count; iRow++)
+        {
+            size_t id = 0, type = 0;
+            double radius = 0;
+            Eigen::Vector3d position = Eigen::Vector3d::Zero();
+            columns.ReadRow(frame.Row(iRow), id, type, position, radius);
+            onRow(id, type, position, radius);
         }
+    }
 
-        fileStream.close();
+    // Same as ReadParticlesFrame for a frame of a binary dump.
+    // columnNames is used if the frame has no column names.
+    template <typename Scalar = double>
+    auto ReadParticlesBinaryFrame(const BinaryDumpFrame &frame, const std::string &source,
+                                  const std::string &columnNames = defaultParticleColumns)
+    {
+        BasicParticles<Scalar> particles;
+        particles.reserve(frame.count);
+
+        ReadParticleBinaryRows(frame, source, [&](size_t id, size_t type, const Eigen::Vector3d &position, double radius)
+                               {
+            auto particle = particles.emplace_back();
+            particle.id = id;
+            particle.type = type;
+            particle.position = position.template cast<Scalar>();
+            particle.radius = radius; }, columnNames);
+
+        SortParticlesById(particles, source);
         return particles;
     }
 
+    // Gives the first frame of a binary dump.
+    auto ReadFirstBinaryFrame(const std::string &fileName)
+    {
+        BinaryDumpFile file(fileName);
+        BinaryDumpFrame frame;
+        if (!file.Next(frame))
+            throw std::runtime_error("\n Error: The below binary dump is empty:\n" + fileName);
+        return frame;
+    }
+
+    // Reads Particles individual properties: x,y,z,radius
+    // from a liggghts dump file and store them.
+    // Returns a vector of this particles.
+    // If the file has many time steps, the first one is read,
+    // see DumpFrames for the others.
+    // .gz and .zst files are decompressed while being read.
+    // .bin files are read as binary dumps.
+    // Scalar is the one of BasicParticle, e.g. ReadParticles<float>.
+    template <typename Scalar = double>
+    auto ReadParticles(std::string fileName)
+    {
+        if (IsBinaryDump(fileName))
+            return ReadParticlesBinaryFrame<Scalar>(ReadFirstBinaryFrame(fileName), fileName);
+
+        if (IsCompressed(fileName))
+        {
+            DecompressedChunks chunks(fileName);
+            ChunkCursor cursor(chunks);
+            return ReadParticlesFrame<Scalar>(cursor, fileName);
+        }
+
+        MappedFile file(fileName);
+        TextCursor cursor(file.View());
+        return ReadParticlesFrame<Scalar>(cursor, fileName);
+    }
+
+    // Calls onRow for every particle of the first frame of a particles
+    // file, see ReadParticleRows, without keeping them. The particles
+    // are in the order of the file, not of their ids.
+    // .gz, .zst and .bin files are read as by ReadParticles.
+    template <typename OnRow>
+    void ReadParticleFileRows(std::string fileName, OnRow onRow)
+    {
+        if (IsBinaryDump(fileName))
+        {
+            ReadParticleBinaryRows(ReadFirstBinaryFrame(fileName), fileName, onRow);
+            return;
+        }
+
+        auto readRows = [&](auto &cursor)
+        {
+            size_t iLine = 0;
+            auto header = ReadDumpHeader(cursor, iLine);
+            ReadParticleRows(cursor, fileName, header, iLine, onRow);
+        };
+
+        if (IsCompressed(fileName))
+        {
+            DecompressedChunks chunks(fileName);
+            ChunkCursor cursor(chunks);
+            readRows(cursor);
+            return;
+        }
+
+        MappedFile file(fileName);
+        TextCursor cursor(file.View());
+        readRows(cursor);
+    }
+
+    // The stresses and forces are initial at zero as they are summed up
+    // in the interaction loop
+    // Makes a contact from the values of a pair file line, id1 and id2
+    // are indices of the particles, see FindParticleIndices. Only radii
+    // of particles are read.
+    template <typename Scalar>
+    auto MakePairContact(const BasicParticles<Scalar> &particles,
+                         int id1, int id2,
+                         const Eigen::Vector3d &x1, const Eigen::Vector3d &x2,
+                         const Eigen::Vector3d &f12, double overlap,
+                         const std::vector<double> &low_bound,
+                         const std::vector<double> &upp_bound)
+    {
+        PairContact contact{id1, id2, f12, Eigen::Vector3d::Zero(), overlap};
+
+        // x12 is from x2, or its periodic image, to x1.
+        Eigen::Vector3d x12 = x1 - GetContactImage(x1, x2, double(particles[id1].radius + particles[id2].radius),
+                                                   low_bound, upp_bound);
+        contact.x12 = x12 / x12.norm();
+        return contact;
+    }
+
+    // Makes a contact from the values of a wall file line, x1 is on
+    // the mesh and x2 the particle center. pid is the particle index.
+    auto MakeWallContact(int pid,
+                         const Eigen::Vector3d &x1, const Eigen::Vector3d &x2,
+                         const Eigen::Vector3d &f12, double overlap)
+    {
+        Eigen::Vector3d x12 = x1 - x2;
+        x12 = x12 / x12.norm();
+
+        // The table keeps the direction toward the particle.
+        return PairContact{pid, ContactTable::wallId, f12, -x12, overlap};
+    }
+
+    // Gives indices of the particles of LIGGGHTS ids id1 and id2.
+    // Contacts of particles that are not read are reported and skipped.
+    bool FindParticleIndices(const ParticleIdMap &idMap, int64_t id1, int64_t id2, int &index1, int &index2)
+    {
+        auto found1 = idMap.Find(id1);
+        auto found2 = idMap.Find(id2);
+        if (found1 == ParticleIdMap::missing || found2 == ParticleIdMap::missing)
+        {
+            std::cout << "A contact of a particle id that is not in the particles file is skipped!\n";
+            return false;
+        }
+        index1 = found1;
+        index2 = found2;
+        return true;
+    }
+
     // Reads Pair interactions from a liggghts CSV file.
-    // Fills particles' neighbors and stress tensor.
-    auto ReadPair(std::vector<Particle> &particles, std::string fileName)
+    // Fills particles' force and stress tensor.
+    template <typename Scalar>
+    auto ReadPair(BasicParticles<Scalar> &particles, std::string fileName)
     {
 
         // Read from the text file
@@ -101,18 +381,14 @@ namespace ForceChain
             throw std::runtime_error("\n Error: The below file does not exist:\n"+fileName);
         }
 
-        // The stresses and forces are initial at zero as they are summed up
-        // in the interaction loop
-        for (auto &&particle : particles)
-        {
-            particle.stress = Eigen::Matrix3d::Zero();
-            particle.force = Eigen::Vector3d::Zero();
-        }
+        ResetStressAndForce(particles);
 
         int iLine = 0;
         std::string line;
         std::vector <double> low_bound(3);
         std::vector <double> upp_bound(3);
+        ContactTable contacts;
+        ParticleIdMap idMap(particles);
 
         while (getline(fileStream, line))
         {
@@ -132,133 +408,429 @@ namespace ForceChain
             }
 
             double overlap;
-            int id1, id2;
+            int64_t id1, id2;
+            int index1, index2;
             bool isPeriodicPair;
             Eigen::Vector3d x1, x2, f12;
 
             
             stream >> x1[0] >> x1[1] >> x1[2] >> x2[0] >> x2[1] >> x2[2] >> id1 >> id2 >> isPeriodicPair >> f12[0] >> f12[1] >> f12[2] >> overlap;
 
+            if (FindParticleIndices(idMap, id1, id2, index1, index2))
+                contacts.Add(MakePairContact(particles, index1, index2, x1, x2, f12, overlap, low_bound, upp_bound));
+        }
 
-            if (id1 > particles.size() - 1 || id2 > particles.size() - 1)
-                std::cout << "The id of a particle cannot be bigger than number of particles!";
-
-            // fill neighbors
-            particles[id1].neighbors.push_back(id2);
-            particles[id2].neighbors.push_back(id1);
+        // Close the file
+        fileStream.close();
+        AddContacts(particles, contacts);
 
-            // calculate stress
-           
-            // adjusts the positions of particle x2 in periodic interaction with x1 
-            //for appropriately calculating the x12 vector
+        std::vector<std::vector<double>> sim_box;
+        sim_box.push_back(low_bound);
+        sim_box.push_back(upp_bound);
+        return sim_box;
+    }
 
-            Eigen::Vector3d x12 = x1 - x2;
-            if (x12.norm()>(particles[id1].radius+particles[id2].radius)){
-                x2=periodic_adjust(x1, x2, low_bound, upp_bound);
-                x12 = x1 - x2;
-            }     
-            x12 = x12 / x12.norm();
+    // Reads one line of a pair file:
+    // p1x p1y p1z p2x p2y p2z id1 id2 isPeriodicInteraction f12x f12y f12z overlap
+    // and moves the cursor to the next line.
+    // Returns false if the line cannot be parsed.
+    template <typename Cursor>
+    bool ReadPairLine(Cursor &cursor, int64_t &id1, int64_t &id2,
+                      Eigen::Vector3d &x1, Eigen::Vector3d &x2,
+                      Eigen::Vector3d &f12, double &overlap)
+    {
+        bool isPeriodicPair;
+        bool isRead = cursor.ReadDouble(x1[0]) && cursor.ReadDouble(x1[1]) && cursor.ReadDouble(x1[2]) &&
+                      cursor.ReadDouble(x2[0]) && cursor.ReadDouble(x2[1]) && cursor.ReadDouble(x2[2]) &&
+                      cursor.ReadInteger(id1) && cursor.ReadInteger(id2) && cursor.ReadBool(isPeriodicPair) &&
+                      cursor.ReadDouble(f12[0]) && cursor.ReadDouble(f12[1]) && cursor.ReadDouble(f12[2]) &&
+                      cursor.ReadDouble(overlap);
+        cursor.SkipLine();
+        return isRead;
+    }
 
-            // fill forces
-            for (size_t i = 0; i < 3; i++)
+    // Calls onRow(id1, id2, x1, x2, f12, overlap) for every line of a
+    // pair frame whose header is read, in the order of the input. ids
+    // are the LIGGGHTS ones. The cursor is left at the start of the
+    // next frame.
+    template <typename Cursor, typename OnRow>
+    void ReadPairRows(Cursor &cursor, const std::string &source, size_t &iLine, OnRow onRow)
+    {
+        while (!cursor.AtEnd() && !cursor.StartsWith("ITEM:"))
+        {
+            iLine++;
+            if (cursor.AtEndOfLine())
             {
-                particles[id1].force(i) +=   f12[i];
-                particles[id2].force(i) +=  - f12[i];
+                cursor.SkipLine();
+                continue;
             }
 
-            double vol1 = particles[id1].getVolume();
-            double vol2 = particles[id2].getVolume();
-
-            // Contract: Compressive stress is negative.
-            // f12 is the force acting on particle 1.
-            // x12 is toward center of particle 1, i.e. 
-            // it is in the direction of compressive force
-            // acting on particle 1.
-            // -f12.x12 = is in direction of negative compression
-            // which is used here.
-            for (size_t i = 0; i < 3; i++)
-            {
-                for (size_t j = 0; j < 3; j++)
-                {
-                    particles[id1].stress(i, j) +=
-                        f12[i] * (-x12[j]) * (particles[id1].radius - overlap / 2.) / vol1;
+            double overlap;
+            int64_t id1, id2;
+            Eigen::Vector3d x1, x2, f12;
 
-                    particles[id2].stress(i, j) +=
-                        -f12[i] * (+x12[j]) * (particles[id2].radius - overlap / 2.) / vol2;
-                }
-            }
+            if (!ReadPairLine(cursor, id1, id2, x1, x2, f12, overlap))
+                throw std::runtime_error("\n Error: Cannot read line " + std::to_string(iLine) +
+                                         " of the below input:\n" + source);
+
+            onRow(id1, id2, x1, x2, f12, overlap);
+        }
+    }
+
+    // Reads pair interactions of one liggghts frame into contacts,
+    // replacing what they held. Particles are only read, for their
+    // radii. The numbers are parsed in place from the text, no line
+    // copies or string streams.
+    // The cursor is left at the start of the next frame.
+    // If verbose, the reading throughput (contacts/s) is printed.
+    template <typename Scalar, typename Cursor>
+    auto ReadPairContactsFrame(const BasicParticles<Scalar> &particles, Cursor &cursor,
+                               const std::string &source, ContactTable &contacts,
+                               bool verbose = false)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+
+        contacts.Clear();
+
+        size_t iLine = 0;
+        auto header = ReadDumpHeader(cursor, iLine);
+        auto &low_bound = header.low_bound;
+        auto &upp_bound = header.upp_bound;
+        contacts.Reserve(header.count);
+        ParticleIdMap idMap(particles);
+
+        ReadPairRows(cursor, source, iLine, [&](int64_t id1, int64_t id2, const Eigen::Vector3d &x1, const Eigen::Vector3d &x2, const Eigen::Vector3d &f12, double overlap)
+                     {
+            int index1, index2;
+            if (FindParticleIndices(idMap, id1, id2, index1, index2))
+                contacts.Add(MakePairContact(particles, index1, index2, x1, x2, f12, overlap, low_bound, upp_bound)); });
+
+        if (verbose)
+        {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+            std::cout << "Read " << contacts.Size() << " contacts from " << source
+                      << " in " << elapsed.count() << " s ("
+                      << contacts.Size() / elapsed.count() << " contacts/s)\n";
         }
 
-        // Close the file
-        fileStream.close();
         std::vector<std::vector<double>> sim_box;
         sim_box.push_back(low_bound);
         sim_box.push_back(upp_bound);
         return sim_box;
     }
 
-    // Reads particle wall interactions from a liggghts CSV file.
-    //  Because stress and force are calculated in sumation way,
-    // first call ReadPair then this.
-    void ReadWall(std::vector<Particle> &particles, std::string fileName)
+    // Reads pair interactions of one liggghts frame and fills
+    // particles' force and stress tensor.
+    // The cursor is left at the start of the next frame.
+    template <typename Scalar, typename Cursor>
+    auto ReadPairFrame(BasicParticles<Scalar> &particles, Cursor &cursor,
+                       const std::string &source, bool verbose = false)
     {
+        ContactTable contacts;
+        auto sim_box = ReadPairContactsFrame(particles, cursor, source, contacts, verbose);
+        ResetStressAndForce(particles);
+        AddContacts(particles, contacts);
+        return sim_box;
+    }
 
-        // Read from the text file
-        std::ifstream fileStream(fileName);
-        if(fileStream.fail()){
-            throw std::runtime_error("\n Error: The below file does not exist:\n"+fileName);
+    // Same as ReadPairRows for a frame of a binary dump with the
+    // columns of a text pair file.
+    template <typename OnRow>
+    void ReadPairBinaryRows(const BinaryDumpFrame &frame, const std::string &source, OnRow onRow)
+    {
+        if (frame.columnsCount < 13)
+            throw std::runtime_error("\n Error: A pair dump needs 13 columns, the below has " +
+                                     std::to_string(frame.columnsCount) + ":\n" + source);
+
+        for (size_t iRow = 0; iRow < frame.count; iRow++)
+        {
+            auto row = frame.Row(iRow);
+            Eigen::Vector3d x1(row[0], row[1], row[2]);
+            Eigen::Vector3d x2(row[3], row[4], row[5]);
+            int64_t id1 = row[6];
+            int64_t id2 = row[7];
+            Eigen::Vector3d f12(row[9], row[10], row[11]);
+            double overlap = row[12];
+            onRow(id1, id2, x1, x2, f12, overlap);
         }
+    }
 
-        
-        int iLine = 0;
-        std::string line;
-        while (getline(fileStream, line))
+    // Same as ReadPairContactsFrame for a frame of a binary dump with
+    // the columns of a text pair file.
+    template <typename Scalar>
+    auto ReadPairContactsBinaryFrame(const BasicParticles<Scalar> &particles, const BinaryDumpFrame &frame,
+                                     const std::string &source, ContactTable &contacts)
+    {
+        contacts.Clear();
+        contacts.Reserve(frame.count);
+        ParticleIdMap idMap(particles);
+
+        ReadPairBinaryRows(frame, source, [&](int64_t id1, int64_t id2, const Eigen::Vector3d &x1, const Eigen::Vector3d &x2, const Eigen::Vector3d &f12, double overlap)
+                           {
+            int index1, index2;
+            if (FindParticleIndices(idMap, id1, id2, index1, index2))
+                contacts.Add(MakePairContact(particles, index1, index2, x1, x2, f12, overlap, frame.low_bound, frame.upp_bound)); });
+
+        std::vector<std::vector<double>> sim_box;
+        sim_box.push_back(frame.low_bound);
+        sim_box.push_back(frame.upp_bound);
+        return sim_box;
+    }
+
+    // Reads the contacts of a pair file, the file is memory mapped and
+    // the numbers are parsed straight from the mapped bytes.
+    // .gz and .zst files are decompressed while being read.
+    // .bin files are read as binary dumps.
+    template <typename Scalar>
+    auto ReadPairContactsMapped(const BasicParticles<Scalar> &particles, std::string fileName,
+                                ContactTable &contacts, bool verbose = false)
+    {
+        if (IsBinaryDump(fileName))
+            return ReadPairContactsBinaryFrame(particles, ReadFirstBinaryFrame(fileName), fileName, contacts);
+
+        if (IsCompressed(fileName))
         {
-            iLine++;
+            DecompressedChunks chunks(fileName);
+            ChunkCursor cursor(chunks);
+            return ReadPairContactsFrame(particles, cursor, fileName, contacts, verbose);
+        }
+
+        MappedFile file(fileName);
+        TextCursor cursor(file.View());
+        return ReadPairContactsFrame(particles, cursor, fileName, contacts, verbose);
+    }
+
+    // Calls onRow for every line of the first frame of a pair file,
+    // see ReadPairRows, without keeping the contacts. Returns the
+    // simulation box, as ReadPairContactsMapped.
+    template <typename OnRow>
+    auto ReadPairFileRows(std::string fileName, OnRow onRow)
+    {
+        std::vector<std::vector<double>> sim_box;
+        if (IsBinaryDump(fileName))
+        {
+            auto frame = ReadFirstBinaryFrame(fileName);
+            ReadPairBinaryRows(frame, fileName, onRow);
+            sim_box.push_back(frame.low_bound);
+            sim_box.push_back(frame.upp_bound);
+            return sim_box;
+        }
+
+        auto readRows = [&](auto &cursor)
+        {
+            size_t iLine = 0;
+            auto header = ReadDumpHeader(cursor, iLine);
+            ReadPairRows(cursor, fileName, iLine, onRow);
+            sim_box.push_back(header.low_bound);
+            sim_box.push_back(header.upp_bound);
+        };
+
+        if (IsCompressed(fileName))
+        {
+            DecompressedChunks chunks(fileName);
+            ChunkCursor cursor(chunks);
+            readRows(cursor);
+            return sim_box;
+        }
+
+        MappedFile file(fileName);
+        TextCursor cursor(file.View());
+        readRows(cursor);
+        return sim_box;
+    }
+
+    // Same as ReadPair, but with ReadPairContactsMapped.
+    template <typename Scalar>
+    auto ReadPairMapped(BasicParticles<Scalar> &particles, std::string fileName,
+                        bool verbose = false)
+    {
+        ContactTable contacts;
+        auto sim_box = ReadPairContactsMapped(particles, fileName, contacts, verbose);
+        ResetStressAndForce(particles);
+        AddContacts(particles, contacts);
+        return sim_box;
+    }
 
-            // skip file headers
-            if (iLine < 10)
+    // Calls onRow(pid, x1, x2, f12, overlap) for every line of a wall
+    // frame whose header is read, in the order of the input. pid is the
+    // LIGGGHTS id of the particle. The cursor is left at the start of
+    // the next frame.
+    template <typename Cursor, typename OnRow>
+    void ReadWallRows(Cursor &cursor, const std::string &source, size_t &iLine, OnRow onRow)
+    {
+        while (!cursor.AtEnd() && !cursor.StartsWith("ITEM:"))
+        {
+            iLine++;
+            if (cursor.AtEndOfLine())
+            {
+                cursor.SkipLine();
                 continue;
+            }
 
             double overlap;
-            int pid, mid, tid; // particle id, mesh id, stl triangle id
+            int64_t pid; // particle id
+            int mid, tid; // mesh id, stl triangle id
             Eigen::Vector3d x1, x2, f12; // x1 is for mesh, x2 particle
 
-            std::stringstream stream(line);
-            stream >> x1[0] >> x1[1] >> x1[2] >> x2[0] >> x2[1] >> x2[2] >> mid >> tid >> pid >> f12[0] >> f12[1] >> f12[2] >> overlap;
+            bool isRead = cursor.ReadDouble(x1[0]) && cursor.ReadDouble(x1[1]) && cursor.ReadDouble(x1[2]) &&
+                          cursor.ReadDouble(x2[0]) && cursor.ReadDouble(x2[1]) && cursor.ReadDouble(x2[2]) &&
+                          cursor.ReadInteger(mid) && cursor.ReadInteger(tid) && cursor.ReadInteger(pid) &&
+                          cursor.ReadDouble(f12[0]) && cursor.ReadDouble(f12[1]) && cursor.ReadDouble(f12[2]) &&
+                          cursor.ReadDouble(overlap);
+            if (!isRead)
+                throw std::runtime_error("\n Error: Cannot read line " + std::to_string(iLine) +
+                                         " of the below input:\n" + source);
+            cursor.SkipLine();
+
+            onRow(pid, x1, x2, f12, overlap);
+        }
+    }
 
+    // Reads particle wall interactions of one liggghts frame into
+    // contacts, replacing what they held.
+    // The cursor is left at the start of the next frame.
+    template <typename Scalar, typename Cursor>
+    void ReadWallContactsFrame(const BasicParticles<Scalar> &particles, Cursor &cursor,
+                               const std::string &source, ContactTable &contacts)
+    {
+        contacts.Clear();
 
-            if (pid > particles.size() - 1)
-                std::cout << "The id of a particle cannot be bigger than number of particles!";
+        size_t iLine = 0;
+        ReadDumpHeader(cursor, iLine);
+        ParticleIdMap idMap(particles);
+
+        ReadWallRows(cursor, source, iLine, [&](int64_t pid, const Eigen::Vector3d &x1, const Eigen::Vector3d &x2, const Eigen::Vector3d &f12, double overlap)
+                     {
+            int index;
+            if (FindParticleIndices(idMap, pid, pid, index, index))
+                contacts.Add(MakeWallContact(index, x1, x2, f12, overlap)); });
+    }
 
+    // Reads particle wall interactions of one liggghts frame and adds
+    // them to force and stress of particles.
+    // The cursor is left at the start of the next frame.
+    template <typename Scalar, typename Cursor>
+    void ReadWallFrame(BasicParticles<Scalar> &particles, Cursor &cursor,
+                       const std::string &source)
+    {
+        ContactTable contacts;
+        ReadWallContactsFrame(particles, cursor, source, contacts);
+        AddContacts(particles, contacts);
+    }
 
-            // calculate stress
-            Eigen::Vector3d x12 = x1 - x2;
-            x12 = x12 / x12.norm();
+    // Same as ReadWallRows for a frame of a binary dump with the
+    // columns of a text wall file.
+    template <typename OnRow>
+    void ReadWallBinaryRows(const BinaryDumpFrame &frame, const std::string &source, OnRow onRow)
+    {
+        if (frame.columnsCount < 13)
+            throw std::runtime_error("\n Error: A wall dump needs 13 columns, the below has " +
+                                     std::to_string(frame.columnsCount) + ":\n" + source);
 
-            // fill forces, note force
-            // have value calculated from ReadPair(),
-            // here we add to that one.
-            for (size_t i = 0; i < 3; i++)
-            {
-                particles[pid].force(i) +=   f12[i];
-            }
+        for (size_t iRow = 0; iRow < frame.count; iRow++)
+        {
+            auto row = frame.Row(iRow);
+            Eigen::Vector3d x1(row[0], row[1], row[2]);
+            Eigen::Vector3d x2(row[3], row[4], row[5]);
+            int64_t pid = row[8];
+            Eigen::Vector3d f12(row[9], row[10], row[11]);
+            double overlap = row[12];
+            onRow(pid, x1, x2, f12, overlap);
+        }
+    }
 
-            double vol = particles[pid].getVolume();
+    // Same as ReadWallContactsFrame for a frame of a binary dump with
+    // the columns of a text wall file.
+    template <typename Scalar>
+    void ReadWallContactsBinaryFrame(const BasicParticles<Scalar> &particles, const BinaryDumpFrame &frame,
+                                     const std::string &source, ContactTable &contacts)
+    {
+        contacts.Clear();
+        contacts.Reserve(frame.count);
+        ParticleIdMap idMap(particles);
+
+        ReadWallBinaryRows(frame, source, [&](int64_t pid, const Eigen::Vector3d &x1, const Eigen::Vector3d &x2, const Eigen::Vector3d &f12, double overlap)
+                           {
+            int index;
+            if (FindParticleIndices(idMap, pid, pid, index, index))
+                contacts.Add(MakeWallContact(index, x1, x2, f12, overlap)); });
+    }
 
-            for (size_t i = 0; i < 3; i++)
-            {
-                for (size_t j = 0; j < 3; j++)
-                {
+    // True if fileName names a wall file the readers accept: text,
+    // compressed (.gz, .zst) or a binary dump (.bin). Other names,
+    // e.g. empty, mean there are no walls.
+    bool IsWallFile(const std::string &fileName)
+    {
+        return fileName.find(".txt") != std::string::npos || IsCompressed(fileName) || IsBinaryDump(fileName);
+    }
 
-                    particles[pid].stress(i, j) +=
-                        f12[i] * (x12[j]) * (particles[pid].radius - overlap / 2.) / vol;
-                }
-            }
+    // Reads the particle wall contacts of a liggghts CSV file.
+    // .gz and .zst files are decompressed while being read.
+    // .bin files are read as binary dumps.
+    template <typename Scalar>
+    void ReadWallContacts(const BasicParticles<Scalar> &particles, std::string fileName,
+                          ContactTable &contacts)
+    {
+        if (IsBinaryDump(fileName))
+        {
+            ReadWallContactsBinaryFrame(particles, ReadFirstBinaryFrame(fileName), fileName, contacts);
+            return;
         }
 
-        // Close the file
-        fileStream.close();
+        if (IsCompressed(fileName))
+        {
+            DecompressedChunks chunks(fileName);
+            ChunkCursor cursor(chunks);
+            ReadWallContactsFrame(particles, cursor, fileName, contacts);
+            return;
+        }
+
+        MappedFile file(fileName);
+        TextCursor cursor(file.View());
+        ReadWallContactsFrame(particles, cursor, fileName, contacts);
+    }
+
+    // Calls onRow for every line of the first frame of a wall file,
+    // see ReadWallRows, without keeping the contacts.
+    template <typename OnRow>
+    void ReadWallFileRows(std::string fileName, OnRow onRow)
+    {
+        if (IsBinaryDump(fileName))
+        {
+            ReadWallBinaryRows(ReadFirstBinaryFrame(fileName), fileName, onRow);
+            return;
+        }
+
+        auto readRows = [&](auto &cursor)
+        {
+            size_t iLine = 0;
+            ReadDumpHeader(cursor, iLine);
+            ReadWallRows(cursor, fileName, iLine, onRow);
+        };
+
+        if (IsCompressed(fileName))
+        {
+            DecompressedChunks chunks(fileName);
+            ChunkCursor cursor(chunks);
+            readRows(cursor);
+            return;
+        }
+
+        MappedFile file(fileName);
+        TextCursor cursor(file.View());
+        readRows(cursor);
+    }
+
+    // Reads particle wall interactions from a liggghts CSV file.
+    //  Because stress and force are calculated in sumation way,
+    // first call ReadPair then this.
+    template <typename Scalar>
+    void ReadWall(BasicParticles<Scalar> &particles, std::string fileName)
+    {
+        ContactTable contacts;
+        ReadWallContacts(particles, fileName, contacts);
+        AddContacts(particles, contacts);
     }
 }
 
+#endif // LIGGGHTSREADER_H
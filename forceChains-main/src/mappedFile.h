@@ -0,0 +1,113 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ForceChain
+{
+    // Maps a whole file read-only into memory, so readers can parse
+    // its bytes in place without copying them into lines and streams.
+    // The mapping is released when the object is destroyed.
+    class MappedFile
+    {
+        int fileDescriptor = -1;
+        const char *data = nullptr;
+        size_t size = 0;
+
+    public:
+        MappedFile(std::string fileName)
+        {
+            fileDescriptor = open(fileName.c_str(), O_RDONLY);
+            if (fileDescriptor < 0)
+                throw std::runtime_error("\n Error: The below file does not exist:\n" + fileName);
+
+            struct stat fileStat;
+            if (fstat(fileDescriptor, &fileStat) != 0)
+            {
+                close(fileDescriptor);
+                throw std::runtime_error("\n Error: The below file cannot be read:\n" + fileName);
+            }
+            size = fileStat.st_size;
+
+            // mmap does not accept empty files, an empty view is enough.
+            if (size == 0)
+                return;
+
+            void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+            if (address == MAP_FAILED)
+            {
+                close(fileDescriptor);
+                throw std::runtime_error("\n Error: The below file cannot be mapped:\n" + fileName);
+            }
+            data = static_cast<const char *>(address);
+
+            // The file is parsed from start to end once.
+            madvise(address, size, MADV_SEQUENTIAL);
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile()
+        {
+            if (data != nullptr)
+                munmap(const_cast<char *>(data), size);
+            if (fileDescriptor >= 0)
+                close(fileDescriptor);
+        }
+
+        std::string_view View() const
+        {
+            return std::string_view(data, size);
+        }
+
+        auto Size() const
+        {
+            return size;
+        }
+
+        // Tells the kernel bytes [begin, end) of the file are not needed
+        // anymore, so their pages are dropped from memory. They are
+        // read again from disk if accessed later.
+        void Release(size_t begin, size_t end)
+        {
+            static const size_t pageSize = sysconf(_SC_PAGESIZE);
+            begin = (begin + pageSize - 1) / pageSize * pageSize;
+            end = end / pageSize * pageSize;
+            if (data == nullptr || begin >= end)
+                return;
+            madvise(const_cast<char *>(data) + begin, end - begin, MADV_DONTNEED);
+        }
+    };
+}
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,106 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <thread>
+#include <vector>
+#include <barrier>
+#include <exception>
+#include <algorithm>
+
+namespace ForceChain
+{
+    // Number of threads used when a thread count of zero is asked.
+    size_t DefaultThreadsCount()
+    {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Runs work(iThread) for iThread in [0, threadsCount) each in its
+    // own thread and waits for all. The first exception thrown by a
+    // thread is thrown again here. With one thread no thread is made.
+    template <typename Work>
+    void ParallelFor(size_t threadsCount, Work work)
+    {
+        if (threadsCount <= 1)
+        {
+            work(size_t(0));
+            return;
+        }
+
+        std::vector<std::exception_ptr> errors(threadsCount);
+        std::vector<std::thread> threads;
+        threads.reserve(threadsCount);
+        for (size_t iThread = 0; iThread < threadsCount; iThread++)
+        {
+            threads.emplace_back([&, iThread]
+                                 {
+                try
+                {
+                    work(iThread);
+                }
+                catch (...)
+                {
+                    errors[iThread] = std::current_exception();
+                } });
+        }
+
+        for (auto &thread : threads)
+            thread.join();
+
+        for (auto &error : errors)
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+
+    // Same as ParallelFor for work made of steps: work(iThread, sync)
+    // calls sync() between steps, which waits until every thread has
+    // called it, so a step can read what other threads wrote in the
+    // step before. One set of threads runs all the steps. A thread
+    // that throws drops out, so the others do not wait for it.
+    template <typename Work>
+    void ParallelSteps(size_t threadsCount, Work work)
+    {
+        threadsCount = std::max<size_t>(1, threadsCount);
+        std::barrier<> barrier(threadsCount);
+        auto sync = [&]
+        { barrier.arrive_and_wait(); };
+
+        ParallelFor(threadsCount, [&](size_t iThread)
+                    {
+            try
+            {
+                work(iThread, sync);
+            }
+            catch (...)
+            {
+                barrier.arrive_and_drop();
+                throw;
+            } });
+    }
+}
+
+#endif // PARALLELFOR_H
@@ -0,0 +1,174 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLELPAIRREADER_H
+#define PARALLELPAIRREADER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include "liggghtsReader.h"
+#include "parallelFor.h"
+
+namespace ForceChain
+{
+    // Same as ReadPairContactsFrame, but the frame text is split at
+    // line ends into one chunk per thread and the chunks are parsed in
+    // parallel. The contacts keep the order of the file.
+    // threadsCount = 0 uses all cores.
+    template <typename Scalar>
+    auto ReadPairContactsFrameParallel(const BasicParticles<Scalar> &particles, std::string_view frame,
+                                       const std::string &source, ContactTable &contacts,
+                                       size_t threadsCount = 0, bool verbose = false)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+
+        TextCursor cursor(frame);
+        size_t iLine = 0;
+        auto header = ReadDumpHeader(cursor, iLine);
+        auto &low_bound = header.low_bound;
+        auto &upp_bound = header.upp_bound;
+
+        // Data ends at the header of the next frame, which starts right
+        // at dataBegin if this frame is empty.
+        size_t dataBegin = cursor.Position() - frame.data();
+        size_t dataEnd = frame.find("\nITEM:", dataBegin);
+        dataEnd = dataEnd == std::string_view::npos ? frame.size() : dataEnd + 1;
+        if (frame.substr(dataBegin).starts_with("ITEM:"))
+            dataEnd = dataBegin;
+
+        // Tiny files are not worth the threads.
+        const size_t minChunkSize = 1 << 16;
+        if (threadsCount == 0)
+            threadsCount = DefaultThreadsCount();
+        threadsCount = std::max<size_t>(1, std::min(threadsCount, (dataEnd - dataBegin) / minChunkSize + 1));
+
+        // Chunk iChunk is [chunkBounds[iChunk], chunkBounds[iChunk+1])
+        std::vector<size_t> chunkBounds(threadsCount + 1, dataEnd);
+        chunkBounds[0] = dataBegin;
+        for (size_t iChunk = 1; iChunk < threadsCount; iChunk++)
+        {
+            auto bound = dataBegin + (dataEnd - dataBegin) * iChunk / threadsCount;
+            bound = std::max(bound, chunkBounds[iChunk - 1]);
+            auto lineEnd = frame.find('\n', bound);
+            chunkBounds[iChunk] = (lineEnd == std::string_view::npos || lineEnd >= dataEnd) ? dataEnd : lineEnd + 1;
+        }
+
+        // Parsing, the expensive part, runs on all chunks together.
+        // The first chunk is read straight into contacts.
+        contacts.Clear();
+        std::vector<ContactTable> chunkContacts(threadsCount - 1);
+        ParticleIdMap idMap(particles);
+        ParallelFor(threadsCount, [&](size_t iChunk)
+                    {
+            auto begin = chunkBounds[iChunk];
+            auto end = chunkBounds[iChunk + 1];
+            TextCursor chunkCursor(frame.substr(begin, end - begin));
+            auto &chunk = iChunk == 0 ? contacts : chunkContacts[iChunk - 1];
+            chunk.Reserve((end - begin) / 100);
+
+            while (!chunkCursor.AtEnd())
+            {
+                if (chunkCursor.AtEndOfLine())
+                {
+                    chunkCursor.SkipLine();
+                    continue;
+                }
+
+                auto lineOffset = chunkCursor.Position() - frame.data();
+                double overlap;
+                int64_t id1, id2;
+                int index1, index2;
+                Eigen::Vector3d x1, x2, f12;
+
+                if (!ReadPairLine(chunkCursor, id1, id2, x1, x2, f12, overlap))
+                    throw std::runtime_error("\n Error: Cannot read the line at byte " + std::to_string(lineOffset) +
+                                             " of the below input:\n" + source);
+
+                if (FindParticleIndices(idMap, id1, id2, index1, index2))
+                    chunk.Add(MakePairContact(particles, index1, index2, x1, x2, f12, overlap, low_bound, upp_bound));
+            } });
+
+        for (auto &&chunk : chunkContacts)
+            contacts.Append(chunk);
+
+        if (verbose)
+        {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+            std::cout << "Read " << contacts.Size() << " contacts from " << source
+                      << " with " << threadsCount << " threads in " << elapsed.count() << " s ("
+                      << contacts.Size() / elapsed.count() << " contacts/s)\n";
+        }
+
+        std::vector<std::vector<double>> sim_box;
+        sim_box.push_back(low_bound);
+        sim_box.push_back(upp_bound);
+        return sim_box;
+    }
+
+    // Same as ReadPairFrame, but parsing and the stresses run on many
+    // threads. Each particle gets its contacts in the file order, so
+    // stress and force come out identical, bit by bit, to
+    // the serial reader. See AddContacts.
+    template <typename Scalar>
+    auto ReadPairFrameParallel(BasicParticles<Scalar> &particles, std::string_view frame,
+                               const std::string &source, size_t threadsCount = 0,
+                               bool verbose = false)
+    {
+        ContactTable contacts;
+        auto sim_box = ReadPairContactsFrameParallel(particles, frame, source, contacts, threadsCount, verbose);
+        ResetStressAndForce(particles);
+        AddContacts(particles, contacts, threadsCount);
+        return sim_box;
+    }
+
+    // Reads the contacts of a pair file with many threads, see
+    // ReadPairContactsFrameParallel. Compressed files are read by
+    // ReadPairContactsMapped, as decompression is one stream, and so
+    // are binary dumps which need no parsing.
+    template <typename Scalar>
+    auto ReadPairContacts(const BasicParticles<Scalar> &particles, std::string fileName,
+                          ContactTable &contacts, size_t threadsCount = 0, bool verbose = false)
+    {
+        if (IsCompressed(fileName) || IsBinaryDump(fileName))
+            return ReadPairContactsMapped(particles, fileName, contacts, verbose);
+
+        MappedFile file(fileName);
+        return ReadPairContactsFrameParallel(particles, file.View(), fileName, contacts, threadsCount, verbose);
+    }
+
+    // Reads a pair file with many threads and fills particles' force
+    // and stress tensor.
+    template <typename Scalar>
+    auto ReadPairParallel(BasicParticles<Scalar> &particles, std::string fileName,
+                          size_t threadsCount = 0, bool verbose = false)
+    {
+        ContactTable contacts;
+        auto sim_box = ReadPairContacts(particles, fileName, contacts, threadsCount, verbose);
+        ResetStressAndForce(particles);
+        AddContacts(particles, contacts, threadsCount);
+        return sim_box;
+    }
+}
+
+#endif // PARALLELPAIRREADER_H
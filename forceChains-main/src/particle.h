@@ -25,8 +25,13 @@
 
 #include <array>
 #include <vector>
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <cmath>
+#include <complex>
+#include <limits>
+#include <sstream>
 #include <iostream>
 #include <Eigen/Dense>
 #include "precision.h"
@@ -34,78 +39,188 @@
 
 namespace ForceChain
 {
-    class Particle
+    // The fields of a particle are kept in three arrays of
+    // BasicParticles, by how often they are read: BasicParticleHot,
+    // BasicParticleCold and BasicParticlePrinciples.
+    //
+    // Scalar is the floating point type of positions, stresses and
+    // principle stresses, double or float. Float halves the memory
+    // and bandwidth of these values in big frames, at the cost of the
+    // last digits. See Particles and ParticlesF below.
+
+    // Fields the chain search reads for every neighbor it tests, so a
+    // cache line holds the ones of about one particle.
+    template <typename Scalar>
+    struct BasicParticleHot
+    {
+        Eigen::Matrix<Scalar, 3, 1> position = Eigen::Matrix<Scalar, 3, 1>::Zero();
+        Eigen::Matrix<Scalar, 3, 1> minorDir = Eigen::Matrix<Scalar, 3, 1>::Zero();
+        Scalar radius = 0;
+        mint chainId = -1; // Negative value means it has no chain
+        bool hasMinorStress = false;
+        // The search flips minorDir, it is dirSign times minorDir until
+        // the search ends, see BasicChainFinder.
+        int8_t dirSign = 1;
+        // Of BasicParticlePrinciples, kept in the padding here as it
+        // would pad principles by 16 bytes.
+        bool arePrincipleStressesSolved = true;
+    };
+
+    // Fields of the readers and the stress analysis.
+    template <typename Scalar>
+    struct BasicParticleCold
+    {
+        size_t id = 0;
+        size_t type = 0;
+        Eigen::Matrix<Scalar, 3, 1> force = Eigen::Matrix<Scalar, 3, 1>::Zero();
+        Eigen::Matrix<Scalar, 3, 3> stress = Eigen::Matrix<Scalar, 3, 3>::Zero();
+        Scalar minorStress = 0;
+    };
+
+    // Principle stresses and directions, mostly read by the outputs.
+    template <typename Scalar>
+    struct BasicParticlePrinciples
+    {
+        Eigen::Matrix<std::complex<Scalar>, 3, 3> principleDirs = Eigen::Matrix<std::complex<Scalar>, 3, 3>::Zero();
+        Eigen::Matrix<std::complex<Scalar>, 3, 1> principleStresses = Eigen::Matrix<std::complex<Scalar>, 3, 1>::Zero();
+    };
+
+    // A particle of BasicParticles: references to its fields in the
+    // arrays. Copies of a particle refer to the same fields, and
+    // assigning a particle to another copies the fields, as for a
+    // reference.
+    template <typename Scalar>
+    class BasicParticle
     {
     public:
-        size_t id;
-        size_t type;
-        double radius;       
-        mint chainId; // Negative value means it has no chain
-        Eigen::Vector3d position;
-        Eigen::Vector3d force;
-        Eigen::Matrix3d stress;
-        Eigen::Matrix3cd principleDirs;
-        Eigen::Vector3cd principleStresses;
-        bool hasMinorStress;
-        double minorStress;
-        Eigen::Vector3d minorDir;
-
-        std::vector<size_t> neighbors;
-        std::vector<size_t> linkages; //vector to store the particle id's which are connected to a given particle
-        std::vector<int> linkNodes; //vector to store the particle id's from which an inward link is identified while travesing the chain 
-
-        Particle()
-        {
-            id = 0;
-            type = 0;
-            chainId = -1;
-            radius = 0;
+        using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
+        using Matrix3 = Eigen::Matrix<Scalar, 3, 3>;
+        using Vector3c = Eigen::Matrix<std::complex<Scalar>, 3, 1>;
+        using Matrix3c = Eigen::Matrix<std::complex<Scalar>, 3, 3>;
+        using Hot = BasicParticleHot<Scalar>;
+        using Cold = BasicParticleCold<Scalar>;
+        using Principles = BasicParticlePrinciples<Scalar>;
 
-            position = Eigen::Vector3d::Zero();
-            force = Eigen::Vector3d::Zero();
-            stress = Eigen::Matrix3d::Zero();
-            principleDirs = Eigen::Matrix3cd::Zero();
-            principleStresses = Eigen::Vector3cd::Zero();
+        size_t &id;
+        size_t &type;
+        Scalar &radius;
+        mint &chainId; // Negative value means it has no chain
+        Vector3 &position;
+        Vector3 &force;
+        Matrix3 &stress;
+        // Solved on first use if only the minor stress was solved, see
+        // setMinorStressAndDir, so const readers may fill them.
+        Matrix3c &principleDirs;
+        Vector3c &principleStresses;
+        bool &arePrincipleStressesSolved;
+        bool &hasMinorStress;
+        Scalar &minorStress;
+        Vector3 &minorDir;
 
-            hasMinorStress = false;
-            minorStress = 0.;
-            minorDir = Eigen::Vector3d::Zero();
+        BasicParticle(Hot &hot, Cold &cold, Principles &principles)
+            : id(cold.id), type(cold.type), radius(hot.radius), chainId(hot.chainId),
+              position(hot.position), force(cold.force), stress(cold.stress),
+              principleDirs(principles.principleDirs), principleStresses(principles.principleStresses),
+              arePrincipleStressesSolved(hot.arePrincipleStressesSolved),
+              hasMinorStress(hot.hasMinorStress), minorStress(cold.minorStress), minorDir(hot.minorDir) {}
+
+        BasicParticle(const BasicParticle &) = default;
+
+        BasicParticle &operator=(const BasicParticle &other)
+        {
+            id = other.id;
+            type = other.type;
+            radius = other.radius;
+            chainId = other.chainId;
+            position = other.position;
+            force = other.force;
+            stress = other.stress;
+            principleDirs = other.principleDirs;
+            principleStresses = other.principleStresses;
+            arePrincipleStressesSolved = other.arePrincipleStressesSolved;
+            hasMinorStress = other.hasMinorStress;
+            minorStress = other.minorStress;
+            minorDir = other.minorDir;
+            return *this;
         }
+
         auto getVolume()
         {
             return 4. / 3. * M_PI * radius * radius * radius;
         }
-        Eigen::Vector3d distanceTo(const Particle &other)
+        Vector3 distanceTo(const BasicParticle &other)
         {
             return position - other.position;
         }
 
+        // Solves principle stresses and directions if they are not yet.
+        // Only those of setMinorStressAndDir are not, so their real
+        // directions take the sign of GetDirectionSign as minorDir does.
+        // It is not thread safe for one particle.
+        void SolvePrincipleStresses() const
+        {
+            if (arePrincipleStressesSolved)
+                return;
+
+            SolveEigen();
+            for (size_t i = 0; i < 3; i++)
+            {
+                if (std::abs(principleStresses[i].imag()) <= epsilon &&
+                    GetDirectionSign(principleDirs.col(i).real()) < 0)
+                    principleDirs.col(i) = -principleDirs.col(i);
+            }
+        }
+
+        // Solves by the general solver, with the signs it gives.
+        void SolveEigen() const
+        {
+            Eigen::EigenSolver<Matrix3> es(stress);
+            principleStresses = es.eigenvalues();
+            principleDirs = es.eigenvectors();
+            arePrincipleStressesSolved = true;
+        }
+
+        // A direction and its negation are one principle direction. The
+        // minor direction of setMinorStressAndDir is a cross product of
+        // either sign, so it takes the sign that makes its largest
+        // component positive.
+        static Scalar GetDirectionSign(const Vector3 &dir)
+        {
+            Eigen::Index largest;
+            dir.cwiseAbs().maxCoeff(&largest);
+            return dir(largest) < 0 ? -1 : 1;
+        }
+
         // The imaginary dir are replaced with zero
         auto GetRealPrincipleDirs() const
         {
-            Eigen::Matrix3d realDirs = principleDirs.real();
+            SolvePrincipleStresses();
+            Matrix3 realDirs = principleDirs.real();
             for (size_t i = 0; i < 3; i++)
             {
                 if (std::abs(principleStresses[i].imag()) > epsilon)
-                    realDirs.col(i) = Eigen::Vector3d::Zero();
+                    realDirs.col(i) = Vector3::Zero();
             }
             return realDirs;
         }
 
         auto AnyImagDir()
         {
+            SolvePrincipleStresses();
             return (principleDirs.imag().array().abs() > epsilon).any();
         }
 
         auto IsImagDir(int dir)
         {
+            SolvePrincipleStresses();
             return (principleDirs.imag().col(dir).array().abs() > epsilon).any();
         }
 
         // The imaginary stresses are replaced with zero
         auto GetRealPrincipleStresses() const
         {
-            Eigen::Vector3d realStresses = principleStresses.real();
+            SolvePrincipleStresses();
+            Vector3 realStresses = principleStresses.real();
             for (size_t i = 0; i < 3; i++)
             {
                 if (std::abs(principleStresses[i].imag()) > epsilon)
@@ -116,11 +231,13 @@ namespace ForceChain
 
         auto AreAllPrincipleStressesReal()
         {
+            SolvePrincipleStresses();
             return (principleStresses.imag().array().abs() < epsilon).all();
         }
 
         auto HasRealNegativePrincipleStress()
         {
+            SolvePrincipleStresses();
             for (size_t i = 0; i < 3; i++)
             {
                 if (principleStresses[i].real() < 0 &&
@@ -132,22 +249,23 @@ namespace ForceChain
 
         auto GetRealPrincipleStressesCount()
         {
+            SolvePrincipleStresses();
             return (principleStresses.imag().array().abs() < epsilon).count();
         }
 
         // returns det(stress - σ I)
-        auto GetDeterminantCharacMatrix(double principleStress)
+        auto GetDeterminantCharacMatrix(Scalar principleStress)
         {
-            return (stress - principleStress * Eigen::Matrix3d::Identity()).determinant();
+            return (stress - principleStress * Matrix3::Identity()).determinant();
         }
 
         // returns det(stress - σ I) for
         // real σ, principle stresses.
         auto GetDeterminantsCharacMatrix()
         {
-            Eigen::Vector3d dets;
+            Vector3 dets;
             for (size_t i = 0; i < 3; i++)
-                dets[i] = (stress - GetRealPrincipleStresses()[i] * Eigen::Matrix3d::Identity()).determinant();
+                dets[i] = (stress - GetRealPrincipleStresses()[i] * Matrix3::Identity()).determinant();
             return dets;
         }
 
@@ -156,7 +274,7 @@ namespace ForceChain
         // Angles are reported less than PI/2.
         auto GetPrincipleDirAngles()
         {
-            Eigen::Vector3d angles(0, 0, 0);
+            Vector3 angles(0, 0, 0);
             if (!AreAllPrincipleStressesReal())
                 return angles;
             auto realDirs = GetRealPrincipleDirs();
@@ -174,13 +292,13 @@ namespace ForceChain
         // stress with x, y and z axis.
         auto GetMinorDirAngles()
         {
-            Eigen::Vector3d angles(0, 0, 0);
+            Vector3 angles(0, 0, 0);
             if (!hasMinorStress)
                 return angles;
             auto realDirs = GetRealPrincipleDirs();
-            angles[0] = angleBetweenVectors(minorDir, Eigen::Vector3d(1, 0, 0));
-            angles[1] = angleBetweenVectors(minorDir, Eigen::Vector3d(0, 1, 0));
-            angles[2] = angleBetweenVectors(minorDir, Eigen::Vector3d(0, 0, 1));
+            angles[0] = angleBetweenVectors(minorDir, Vector3(1, 0, 0));
+            angles[1] = angleBetweenVectors(minorDir, Vector3(0, 1, 0));
+            angles[2] = angleBetweenVectors(minorDir, Vector3(0, 0, 1));
 
             for (size_t i = 0; i < 3; i++)
                 angles[i] = angles[i] <= M_PI_2 ? angles[i] : M_PI - angles[i];
@@ -190,11 +308,9 @@ namespace ForceChain
 
         auto setPrincipleStressAndDir()
         {
-            Eigen::EigenSolver<Eigen::Matrix3d> es(stress);
-            principleStresses = es.eigenvalues();
-            principleDirs = es.eigenvectors();
+            SolveEigen();
 
-            minorStress = std::numeric_limits<double>::max();
+            minorStress = std::numeric_limits<Scalar>::max();
             size_t minorId = -1;
             hasMinorStress = false;
 
@@ -223,8 +339,75 @@ namespace ForceChain
             }
         }
 
+        // Same minor stress and direction as setPrincipleStressAndDir,
+        // but only eigen values are solved, which is cheaper. The
+        // direction is normal to two rows of stress - minorStress I.
+        // The other principle stresses and directions are left to
+        // SolvePrincipleStresses, on first use.
+        auto setMinorStressAndDir()
+        {
+            Eigen::EigenSolver<Matrix3> es(stress, false);
+            Vector3c values = es.eigenvalues();
+            arePrincipleStressesSolved = false;
+
+            minorStress = std::numeric_limits<Scalar>::max();
+            hasMinorStress = false;
+
+            for (size_t i = 0; i < 3; i++)
+            {
+                if (std::abs(values(i).imag()) > epsilon)
+                    continue;
+                minorStress = std::min(minorStress, values(i).real());
+            }
+
+            // only compressive stress accounted
+            if (minorStress < -1e-14)
+            {
+                hasMinorStress = true;
+
+                Matrix3 shifted = stress - minorStress * Matrix3::Identity();
+                Vector3 normal = Vector3::Zero();
+                for (size_t i = 0; i < 3; i++)
+                {
+                    Vector3 cross = shifted.row(i).cross(shifted.row((i + 1) % 3));
+                    if (cross.squaredNorm() > normal.squaredNorm())
+                        normal = cross;
+                }
+
+                // A repeated minor stress has a plane of directions,
+                // the general solver picks one.
+                if (normal.norm() <= Scalar(1e-10) * shifted.squaredNorm())
+                {
+                    setPrincipleStressAndDir();
+                    return;
+                }
+                minorDir = normal.normalized();
+                minorDir *= GetDirectionSign(minorDir);
+            }
+        }
+
+        // Sets real principle stresses sorted from minor to major,
+        // and their directions as columns of dirs.
+        auto setPrincipleStressAndDir(const Vector3 &values, const Matrix3 &dirs)
+        {
+            principleStresses = values.template cast<std::complex<Scalar>>();
+            principleDirs = dirs.template cast<std::complex<Scalar>>();
+            arePrincipleStressesSolved = true;
+
+            minorStress = values[0];
+            hasMinorStress = false;
+
+            // only compressive stress accounted
+            if (minorStress < -1e-14)
+            {
+                hasMinorStress = true;
+                minorDir = dirs.col(0);
+            }
+        }
+
         auto GetStressInfo()
         {
+            SolvePrincipleStresses();
             std::stringstream out;
              out << "Force  = \n" << force << "\n";
             out << "Stress  = \n" << stress << "\n";
@@ -260,5 +443,126 @@ namespace ForceChain
             std::cout << GetStressInfo();
         }
     };
+
+    // Particles of a frame, their fields in a hot, a cold and a
+    // principles array, see BasicParticleHot. particles[i] is the
+    // BasicParticle of the fields of particle i. The chain search
+    // reads the hot array only, so it loads no stress of particles.
+    template <typename Scalar>
+    class BasicParticles
+    {
+    public:
+        using Particle = BasicParticle<Scalar>;
+        using Hot = BasicParticleHot<Scalar>;
+        using Cold = BasicParticleCold<Scalar>;
+        using Principles = BasicParticlePrinciples<Scalar>;
+
+        static constexpr size_t bytesPerParticle = sizeof(Hot) + sizeof(Cold) + sizeof(Principles);
+
+        std::vector<Hot> hot;
+        std::vector<Cold> cold;
+        std::vector<Principles> principles;
+
+        // Gives particles in order, as BasicParticle values.
+        class Iterator
+        {
+            BasicParticles *particles;
+            size_t i;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Particle;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Particle;
+
+            Iterator(BasicParticles *particles_, size_t i_) : particles(particles_), i(i_) {}
+
+            Particle operator*() const { return (*particles)[i]; }
+            Iterator &operator++()
+            {
+                i++;
+                return *this;
+            }
+            Iterator operator++(int)
+            {
+                auto old = *this;
+                i++;
+                return old;
+            }
+            bool operator==(const Iterator &other) const { return i == other.i; }
+            bool operator!=(const Iterator &other) const { return i != other.i; }
+        };
+
+        auto size() const { return hot.size(); }
+        auto empty() const { return hot.empty(); }
+
+        void resize(size_t count)
+        {
+            hot.resize(count);
+            cold.resize(count);
+            principles.resize(count);
+        }
+
+        void reserve(size_t count)
+        {
+            hot.reserve(count);
+            cold.reserve(count);
+            principles.reserve(count);
+        }
+
+        void clear()
+        {
+            hot.clear();
+            cold.clear();
+            principles.clear();
+        }
+
+        // count particles of default fields, as constructed.
+        void assign(size_t count)
+        {
+            clear();
+            resize(count);
+        }
+
+        Particle operator[](size_t i)
+        {
+            return Particle(hot[i], cold[i], principles[i]);
+        }
+
+        // The particle still refers to the fields, which const readers
+        // such as SolvePrincipleStresses may fill.
+        Particle operator[](size_t i) const
+        {
+            return const_cast<BasicParticles &>(*this)[i];
+        }
+
+        Particle back() { return (*this)[size() - 1]; }
+
+        // Adds a particle of default fields.
+        Particle emplace_back()
+        {
+            hot.emplace_back();
+            cold.emplace_back();
+            principles.emplace_back();
+            return back();
+        }
+
+        // Adds a copy of the fields of particle.
+        void push_back(const Particle &particle)
+        {
+            emplace_back() = particle;
+        }
+
+        Iterator begin() { return Iterator(this, 0); }
+        Iterator end() { return Iterator(this, size()); }
+        Iterator begin() const { return Iterator(const_cast<BasicParticles *>(this), 0); }
+        Iterator end() const { return Iterator(const_cast<BasicParticles *>(this), size()); }
+    };
+
+    using Particle = BasicParticle<double>;
+    using ParticleF = BasicParticle<float>;
+    using Particles = BasicParticles<double>;
+    using ParticlesF = BasicParticles<float>;
 }
 #endif // PARTICLE_H
\ No newline at end of file
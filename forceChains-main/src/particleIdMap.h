@@ -0,0 +1,144 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARTICLEIDMAP_H
+#define PARTICLEIDMAP_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "particle.h"
+
+namespace ForceChain
+{
+    // Maps LIGGGHTS ids of particles to their index in particles, so
+    // ids may have gaps, e.g. of deleted particles, or be in billions.
+    // Ids that span at most a few times the particles count are looked
+    // up in a table, the others in an open addressing hash with linear
+    // probing.
+    class ParticleIdMap
+    {
+        static constexpr uint32_t empty = UINT32_MAX;
+
+        uint64_t firstId = 0;
+        // Index of id firstId + k, or empty.
+        std::vector<uint32_t> table;
+
+        // Open addressing hash, its size is a power of two.
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> values;
+        uint64_t mask = 0;
+
+        auto Slot(uint64_t id) const
+        {
+            return (id * 0x9E3779B97F4A7C15ull >> 32) & mask;
+        }
+
+        // idOf(i) is the id of the i-th of count particles.
+        template <typename IdOf>
+        void Build(size_t count, IdOf idOf)
+        {
+            if (count == 0)
+                return;
+
+            uint64_t lastId = 0;
+            firstId = UINT64_MAX;
+            for (size_t i = 0; i < count; i++)
+            {
+                firstId = std::min<uint64_t>(firstId, idOf(i));
+                lastId = std::max<uint64_t>(lastId, idOf(i));
+            }
+
+            if (lastId - firstId < 4 * count + 1024)
+            {
+                table.assign(lastId - firstId + 1, empty);
+                for (size_t i = 0; i < count; i++)
+                    table[idOf(i) - firstId] = i;
+                return;
+            }
+
+            size_t capacity = 1;
+            while (capacity < 2 * count)
+                capacity *= 2;
+            mask = capacity - 1;
+            keys.resize(capacity);
+            values.assign(capacity, empty);
+            for (size_t i = 0; i < count; i++)
+            {
+                auto slot = Slot(idOf(i));
+                while (values[slot] != empty)
+                    slot = (slot + 1) & mask;
+                keys[slot] = idOf(i);
+                values[slot] = i;
+            }
+        }
+
+    public:
+        static constexpr size_t missing = SIZE_MAX;
+
+        ParticleIdMap() = default;
+
+        template <typename Scalar>
+        explicit ParticleIdMap(const BasicParticles<Scalar> &particles)
+        {
+            Build(particles.size(), [&](size_t i)
+                  { return uint64_t(particles[i].id); });
+        }
+
+        // Maps ids[i] to i, for particles kept apart from
+        // BasicParticle, see BasicTiledChainFinder.
+        explicit ParticleIdMap(const std::vector<size_t> &ids)
+        {
+            Build(ids.size(), [&](size_t i)
+                  { return uint64_t(ids[i]); });
+        }
+
+        // Bytes of the table and the hash.
+        size_t GetBytes() const
+        {
+            return table.size() * sizeof(uint32_t) + keys.size() * sizeof(uint64_t) + values.size() * sizeof(uint32_t);
+        }
+
+        // Index of the particle of id, or missing.
+        size_t Find(int64_t id) const
+        {
+            if (!table.empty())
+            {
+                if (id < int64_t(firstId) || uint64_t(id) - firstId >= table.size())
+                    return missing;
+                auto index = table[id - firstId];
+                return index == empty ? missing : index;
+            }
+
+            if (values.empty() || id < 0)
+                return missing;
+            for (auto slot = Slot(id); values[slot] != empty; slot = (slot + 1) & mask)
+            {
+                if (keys[slot] == uint64_t(id))
+                    return values[slot];
+            }
+            return missing;
+        }
+    };
+}
+
+#endif // PARTICLEIDMAP_H
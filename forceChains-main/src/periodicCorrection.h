@@ -20,6 +20,9 @@
 # along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifndef PERIODICCORRECTION_H
+#define PERIODICCORRECTION_H
+
 #include <iostream>
 #include <vector>
 #include "particle.h"
@@ -29,13 +32,14 @@
 namespace ForceChain
 {
     // This code adjusts the positions of particle x2 in periodic interaction with x1 for appropriately calculating the x12 vector  
-    auto periodic_adjust(Eigen::Vector3d x1, Eigen::Vector3d x2,
-                        std::vector <double> low_bound,
-                        std::vector <double> upp_bound) 
+    template <typename Scalar>
+    auto periodic_adjust(const Eigen::Matrix<Scalar, 3, 1> &x1, Eigen::Matrix<Scalar, 3, 1> x2,
+                        const std::vector <double> &low_bound,
+                        const std::vector <double> &upp_bound) 
     {
         double margin;
         size_t i=0;
-        Eigen::Vector3d x12=x1-x2;
+        Eigen::Matrix<Scalar, 3, 1> x12=x1-x2;
 
         // Finding the direction of periodicity
         if (std::abs(x12[1])>std::abs(x12[0]))
@@ -57,4 +61,21 @@ namespace ForceChain
 
         return x2;      
     }
-}
\ No newline at end of file
+
+    // Position of x2, or of its periodic image, next to x1 for two
+    // particles in contact: the image is taken if x2 is farther than
+    // contactDistance, the sum of their radii.
+    template <typename Scalar>
+    Eigen::Matrix<Scalar, 3, 1> GetContactImage(const Eigen::Matrix<Scalar, 3, 1> &x1,
+                                                const Eigen::Matrix<Scalar, 3, 1> &x2,
+                                                Scalar contactDistance,
+                                                const std::vector<double> &low_bound,
+                                                const std::vector<double> &upp_bound)
+    {
+        if ((x2 - x1).norm() > contactDistance)
+            return periodic_adjust(x1, x2, low_bound, upp_bound);
+        return x2;
+    }
+}
+
+#endif // PERIODICCORRECTION_H
@@ -29,35 +29,45 @@
 
 namespace ForceChain
 {
-    class SectionFilter : public Filter
+    template <typename Scalar>
+    class BasicSectionFilter : public BasicFilter<Scalar>
     {
     public:
         virtual void WriteGeo(const std::string fileName) = 0;
     };
 
-    class BoxFilter : public SectionFilter
+    template <typename Scalar>
+    class BasicBoxFilter : public BasicSectionFilter<Scalar>
     {
     public:
         Eigen::Vector3d xmin;
         Eigen::Vector3d xmax;
 
-        BoxFilter(double x0, double x1,
+        BasicBoxFilter(double x0, double x1,
                   double y0, double y1,
                   double z0, double z1)
             : xmin(x0, y0, z0), xmax(x1, y1, z1) {}
 
-        bool IsInside(const Particle &particle) override
+        bool IsInside(const BasicParticle<Scalar> &particle) override
         {
-
-            for (size_t i = 0; i < 3; i++)
-            {
-                if (particle.position(i) < xmin(i) ||
-                    particle.position(i) > xmax(i))
-                    return false;
-            }
-            return true;
+            return IsInsidePosition(particle.position(0), particle.position(1), particle.position(2));
         };
 
+        // IsInside of particle i of columns, see FilterExpression.
+        bool IsInside(const BasicFilterColumns<Scalar> &columns, size_t i) const
+        {
+            return IsInsidePosition(columns.x[i], columns.y[i], columns.z[i]);
+        }
+
+        // Without branches, so filter expressions test rows of
+        // particles quickly.
+        bool IsInsidePosition(Scalar x, Scalar y, Scalar z) const
+        {
+            return !(x < xmin(0)) & !(x > xmax(0)) &
+                   !(y < xmin(1)) & !(y > xmax(1)) &
+                   !(z < xmin(2)) & !(z > xmax(2));
+        }
+
         void WriteGeo(const std::string fileName) override
         {
             auto fileStream = std::ofstream(fileName);
@@ -81,20 +91,66 @@ namespace ForceChain
         }
     };
 
-    class SphereFilter : public SectionFilter
+    template <typename Scalar>
+    class BasicSphereFilter : public BasicSectionFilter<Scalar>
     {
     public:
         double radius;
         Eigen::Vector3d center;
 
-        SphereFilter(Eigen::Vector3d center_, double radius_)
+        BasicSphereFilter(Eigen::Vector3d center_, double radius_)
             : center(center_), radius(radius_) {}
 
-        bool IsInside(const Particle &particle) override
+        bool IsInside(const BasicParticle<Scalar> &particle) override
         {
-            auto dist = (particle.position - center).norm();
-            return dist <= radius;
+            return IsInsidePosition(particle.position(0), particle.position(1), particle.position(2));
         };
+
+        // IsInside of particle i of columns, see FilterExpression.
+        bool IsInside(const BasicFilterColumns<Scalar> &columns, size_t i) const
+        {
+            return IsInsidePosition(columns.x[i], columns.y[i], columns.z[i]);
+        }
+
+        bool IsInsidePosition(Scalar x, Scalar y, Scalar z) const
+        {
+            auto dist = (Eigen::Vector3d(x, y, z) - center).norm();
+            return dist <= radius;
+        }
+
+        // Writes the sphere as a grid of latitudes and longitudes.
+        void WriteGeo(const std::string fileName) override
+        {
+            auto fileStream = std::ofstream(fileName);
+            if (fileStream.fail())
+            {
+                throw std::runtime_error("\n Error: The below file cannot be created:\n" + fileName);
+            }
+
+            size_t latitudesCount = 17, longitudesCount = 33;
+            fileStream << "# vtk DataFile Version 4.0\n"
+                       << "Sphere filter surface of Force Chain Finder\n"
+                       << "ASCII\n"
+                       << "DATASET STRUCTURED_GRID\n"
+                       << "DIMENSIONS " << longitudesCount << " " << latitudesCount << " 1\n"
+                       << "POINTS " << longitudesCount * latitudesCount << " double\n";
+            for (size_t i = 0; i < latitudesCount; i++)
+            {
+                auto theta = M_PI * i / (latitudesCount - 1);
+                for (size_t j = 0; j < longitudesCount; j++)
+                {
+                    auto phi = 2 * M_PI * j / (longitudesCount - 1);
+                    fileStream << center[0] + radius * std::sin(theta) * std::cos(phi) << " "
+                               << center[1] + radius * std::sin(theta) * std::sin(phi) << " "
+                               << center[2] + radius * std::cos(theta) << "\n";
+                }
+            }
+            fileStream.close();
+        }
     };
+
+    using SectionFilter = BasicSectionFilter<double>;
+    using BoxFilter = BasicBoxFilter<double>;
+    using SphereFilter = BasicSphereFilter<double>;
 }
 #endif // SECTIONFILTER_H
\ No newline at end of file
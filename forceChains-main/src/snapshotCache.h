@@ -0,0 +1,281 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPSHOTCACHE_H
+#define SNAPSHOTCACHE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <complex>
+#include <cstring>
+#include <cstdint>
+#include "particle.h"
+#include "contactGraph.h"
+#include "mappedFile.h"
+#include "byteReader.h"
+
+namespace ForceChain
+{
+    // Size and last modification time of an input file. A snapshot
+    // is valid only while the stamps of its inputs are unchanged.
+    struct SourceStamp
+    {
+        uint64_t size = 0;
+        int64_t modifiedTime = 0;
+
+        bool operator==(const SourceStamp &) const = default;
+    };
+
+    // A missing or empty file name, e.g. no wall file, has zero stamp.
+    auto GetSourceStamp(const std::string &fileName)
+    {
+        SourceStamp stamp;
+        std::error_code error;
+        if (fileName.empty() || !std::filesystem::exists(fileName, error))
+            return stamp;
+        stamp.size = std::filesystem::file_size(fileName, error);
+        stamp.modifiedTime = std::filesystem::last_write_time(fileName, error).time_since_epoch().count();
+        return stamp;
+    }
+
+    // A binary snapshot of a frame after reading and stress analysis:
+    // particles' id, type, radius, position, force, stress, principle
+    // stresses and directions, whether these are solved, minor stress
+    // and the contacts as the rows of their ContactGraph, plus the
+    // simulation box.
+    // Running the same frame again, e.g. with another alpha or filter,
+    // loads it instead of parsing text and solving eigen values again.
+    //
+    // Layout: a header of magic, version, byte order mark, names and
+    // stamps of the source files, the analysis name, then every
+    // property as one contiguous array, so loading is mostly memcpy.
+    // Snapshots of another version, another analysis or with changed
+    // sources are ignored by Load and should be saved again.
+    // Values are kept in double for particles of any Scalar.
+    class SnapshotCache
+    {
+        std::string cacheFile;
+        std::vector<std::string> sourceFiles;
+        // Names how stresses were analysed, e.g. the eigen solver.
+        std::string analysis;
+
+        static constexpr char magic[8] = {'F', 'C', 'F', 'S', 'N', 'A', 'P', '\0'};
+        static constexpr uint32_t byteOrderMark = 0x01020304;
+
+        template <typename T>
+        static void Write(std::ofstream &stream, const T *values, size_t count)
+        {
+            stream.write(reinterpret_cast<const char *>(values), count * sizeof(T));
+        }
+
+        template <typename T>
+        static void Write(std::ofstream &stream, const T &value)
+        {
+            Write(stream, &value, 1);
+        }
+
+    public:
+        // Increase when the layout or the meaning of values changes, older
+        // snapshots are rebuilt.
+        static constexpr uint32_t version = 6;
+
+        SnapshotCache(std::string cacheFile_, std::vector<std::string> sourceFiles_,
+                      std::string analysis_ = "")
+            : cacheFile(cacheFile_), sourceFiles(sourceFiles_), analysis(analysis_) {}
+
+        // Fills particles, graph and box from the snapshot. Returns
+        // false if there is no valid snapshot for the current sources.
+        template <typename Scalar>
+        bool Load(BasicParticles<Scalar> &particles, ContactGraph &graph,
+                  std::vector<std::vector<double>> &box)
+        {
+            if (!std::filesystem::exists(cacheFile))
+                return false;
+
+            MappedFile file(cacheFile);
+            ByteReader reader(file.View());
+
+            char fileMagic[8];
+            uint32_t fileVersion, fileByteOrderMark;
+            uint64_t sourcesCount;
+            if (!reader.Read(fileMagic, 8) || std::memcmp(fileMagic, magic, 8) != 0 ||
+                !reader.Read(fileVersion) || fileVersion != version ||
+                !reader.Read(fileByteOrderMark) || fileByteOrderMark != byteOrderMark ||
+                !reader.Read(sourcesCount) || sourcesCount != sourceFiles.size())
+                return false;
+
+            for (auto &&sourceFile : sourceFiles)
+            {
+                SourceStamp stamp;
+                uint64_t nameSize;
+                if (!reader.Read(nameSize) || nameSize != sourceFile.size())
+                    return false;
+                std::string name(nameSize, ' ');
+                if (!reader.Read(name.data(), nameSize) || name != sourceFile ||
+                    !reader.Read(stamp.size) || !reader.Read(stamp.modifiedTime) ||
+                    !(stamp == GetSourceStamp(sourceFile)))
+                    return false;
+            }
+
+            uint64_t analysisSize;
+            if (!reader.Read(analysisSize) || analysisSize != analysis.size())
+                return false;
+            std::string fileAnalysis(analysisSize, ' ');
+            if (!reader.Read(fileAnalysis.data(), analysisSize) || fileAnalysis != analysis)
+                return false;
+
+            uint64_t particlesCount, neighborsCount;
+            std::vector<double> low_bound(3), upp_bound(3);
+            if (!reader.Read(particlesCount) || !reader.Read(neighborsCount) ||
+                !reader.Read(low_bound.data(), 3) || !reader.Read(upp_bound.data(), 3))
+                return false;
+
+            auto n = particlesCount;
+            std::vector<uint64_t> ids(n), types(n), neighborsOffsets(n + 1), neighbors(neighborsCount);
+            std::vector<double> radii(n), positions(3 * n), forces(3 * n), stresses(9 * n);
+            std::vector<std::complex<double>> principleStresses(3 * n), principleDirs(9 * n);
+            std::vector<uint8_t> areSolved(n), hasMinorStresses(n);
+            std::vector<double> minorStresses(n), minorDirs(3 * n);
+
+            if (!reader.Read(ids.data(), n) || !reader.Read(types.data(), n) ||
+                !reader.Read(radii.data(), n) || !reader.Read(positions.data(), 3 * n) ||
+                !reader.Read(forces.data(), 3 * n) || !reader.Read(stresses.data(), 9 * n) ||
+                !reader.Read(principleStresses.data(), 3 * n) || !reader.Read(principleDirs.data(), 9 * n) ||
+                !reader.Read(areSolved.data(), n) || !reader.Read(hasMinorStresses.data(), n) || !reader.Read(minorStresses.data(), n) ||
+                !reader.Read(minorDirs.data(), 3 * n) ||
+                !reader.Read(neighborsOffsets.data(), n + 1) || !reader.Read(neighbors.data(), neighborsCount) ||
+                neighborsOffsets[n] != neighborsCount)
+                return false;
+
+            particles.assign(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                auto particle = particles[i];
+                particle.id = ids[i];
+                particle.type = types[i];
+                particle.radius = radii[i];
+                particle.position = Eigen::Vector3d::Map(&positions[3 * i]).template cast<Scalar>();
+                particle.force = Eigen::Vector3d::Map(&forces[3 * i]).template cast<Scalar>();
+                particle.stress = Eigen::Matrix3d::Map(&stresses[9 * i]).template cast<Scalar>();
+                particle.principleStresses = Eigen::Vector3cd::Map(&principleStresses[3 * i]).template cast<std::complex<Scalar>>();
+                particle.principleDirs = Eigen::Matrix3cd::Map(&principleDirs[9 * i]).template cast<std::complex<Scalar>>();
+                particle.arePrincipleStressesSolved = areSolved[i];
+                particle.hasMinorStress = hasMinorStresses[i];
+                particle.minorStress = minorStresses[i];
+                particle.minorDir = Eigen::Vector3d::Map(&minorDirs[3 * i]).template cast<Scalar>();
+            }
+            graph.offsets.assign(neighborsOffsets.begin(), neighborsOffsets.end());
+            graph.values.assign(neighbors.begin(), neighbors.end());
+
+            box = {low_bound, upp_bound};
+            return true;
+        }
+
+        // Writes the snapshot of particles whose stresses are analysed,
+        // and their graph. Principle stresses left to be solved on first
+        // use, see setMinorStressAndDir, are kept so and not solved here.
+        // It is written to a temporary file first and then renamed,
+        // so a broken run never leaves a half written snapshot.
+        template <typename Scalar>
+        void Save(const BasicParticles<Scalar> &particles, const ContactGraph &graph,
+                  const std::vector<std::vector<double>> &box)
+        {
+            auto n = particles.size();
+            if (graph.RowsCount() != n)
+                throw std::runtime_error("\n Error: The contact graph does not match the particles of the snapshot:\n" + cacheFile);
+            std::vector<uint64_t> ids(n), types(n);
+            std::vector<uint64_t> neighborsOffsets(graph.offsets.begin(), graph.offsets.end());
+            std::vector<uint64_t> neighbors(graph.values.begin(), graph.values.end());
+            std::vector<double> radii(n), positions(3 * n), forces(3 * n), stresses(9 * n);
+            std::vector<std::complex<double>> principleStresses(3 * n), principleDirs(9 * n);
+            std::vector<uint8_t> areSolved(n), hasMinorStresses(n);
+            std::vector<double> minorStresses(n), minorDirs(3 * n);
+
+            for (size_t i = 0; i < n; i++)
+            {
+                auto particle = particles[i];
+                ids[i] = particle.id;
+                types[i] = particle.type;
+                radii[i] = particle.radius;
+                Eigen::Vector3d::Map(&positions[3 * i]) = particle.position.template cast<double>();
+                Eigen::Vector3d::Map(&forces[3 * i]) = particle.force.template cast<double>();
+                Eigen::Matrix3d::Map(&stresses[9 * i]) = particle.stress.template cast<double>();
+                Eigen::Vector3cd::Map(&principleStresses[3 * i]) = particle.principleStresses.template cast<std::complex<double>>();
+                Eigen::Matrix3cd::Map(&principleDirs[9 * i]) = particle.principleDirs.template cast<std::complex<double>>();
+                areSolved[i] = particle.arePrincipleStressesSolved;
+                hasMinorStresses[i] = particle.hasMinorStress;
+                minorStresses[i] = particle.minorStress;
+                Eigen::Vector3d::Map(&minorDirs[3 * i]) = particle.minorDir.template cast<double>();
+            }
+
+            auto tempFile = cacheFile + ".tmp";
+            std::ofstream stream(tempFile, std::ios::binary);
+            if (stream.fail())
+                throw std::runtime_error("\n Error: The below file cannot be created:\n" + tempFile);
+
+            Write(stream, magic, 8);
+            Write(stream, version);
+            Write(stream, byteOrderMark);
+            Write(stream, uint64_t(sourceFiles.size()));
+            for (auto &&sourceFile : sourceFiles)
+            {
+                auto stamp = GetSourceStamp(sourceFile);
+                Write(stream, uint64_t(sourceFile.size()));
+                Write(stream, sourceFile.data(), sourceFile.size());
+                Write(stream, stamp.size);
+                Write(stream, stamp.modifiedTime);
+            }
+
+            Write(stream, uint64_t(analysis.size()));
+            Write(stream, analysis.data(), analysis.size());
+
+            Write(stream, uint64_t(n));
+            Write(stream, uint64_t(neighbors.size()));
+            Write(stream, box[0].data(), 3);
+            Write(stream, box[1].data(), 3);
+
+            Write(stream, ids.data(), n);
+            Write(stream, types.data(), n);
+            Write(stream, radii.data(), n);
+            Write(stream, positions.data(), 3 * n);
+            Write(stream, forces.data(), 3 * n);
+            Write(stream, stresses.data(), 9 * n);
+            Write(stream, principleStresses.data(), 3 * n);
+            Write(stream, principleDirs.data(), 9 * n);
+            Write(stream, areSolved.data(), n);
+            Write(stream, hasMinorStresses.data(), n);
+            Write(stream, minorStresses.data(), n);
+            Write(stream, minorDirs.data(), 3 * n);
+            Write(stream, neighborsOffsets.data(), n + 1);
+            Write(stream, neighbors.data(), neighbors.size());
+
+            stream.close();
+            if (stream.fail())
+                throw std::runtime_error("\n Error: The below file cannot be written:\n" + tempFile);
+            std::filesystem::rename(tempFile, cacheFile);
+        }
+    };
+}
+
+#endif // SNAPSHOTCACHE_H
@@ -26,18 +26,38 @@
 #include <vector>
 #include "particle.h"
 #include "filter.h"
+#include "filterExpression.h"
 #include <memory>
 #include "regression.h"
 #include <tuple>
 
 namespace ForceChain
 {
+    // Lengths of sample chains, see BasicStat::GetSummary.
+    struct ChainsSummary
+    {
+        size_t chainsCount = 0;
+        size_t minLength = 0;
+        size_t maxLength = 0;
+        double averageLength = 0;
+        double medianLength = 0;
+    };
+
     // Calculates statistics of sample chains
-    class Stat
+    template <typename Scalar>
+    class BasicStat
     {
+        using Particle = BasicParticle<Scalar>;
+        using Filter = BasicFilter<Scalar>;
+
         std::vector<size_t> sampleChainIds;
-        const std::vector<Particle> &particles;
         const std::vector<std::vector<size_t>> &chains;
+        const BasicParticles<Scalar> &particles;
+
+        // Fields of particles of chains read by filter expressions, set
+        // by the first one after ResetSamples.
+        BasicFilterColumns<Scalar> columns;
+        bool areColumnsSet = false;
 
     public:
         const auto &GetSampleChainIds()
@@ -52,7 +72,7 @@ namespace ForceChain
 
             for (auto &&chainId : sampleChainIds)
             {
-                auto chain = chains[chainId];
+                auto &chain = chains[chainId];
                 bool allInside = true;
                 for (auto &&particleId : chain)
                 {
@@ -95,11 +115,44 @@ namespace ForceChain
             return sampleChainIds;
         }
 
+        // Bits of all the chains, not only samples, that expression
+        // accepts, see FilterExpression.
+        template <typename Expression>
+        auto SelectChains(const Expression &expression)
+        {
+            if (!areColumnsSet)
+            {
+                columns.Set(particles, chains);
+                areColumnsSet = true;
+            }
+
+            FilterBits bits;
+            expression.Select(columns, bits);
+            return bits;
+        }
+
+        // Accepts chains that expression accepts, e.g.
+        // AllOf(boxFilter) && AnyOf(stressFilter), see FilterExpression.
+        template <typename Expression>
+        auto ApplyFilter(const Expression &expression)
+        {
+            auto bits = SelectChains(expression);
+            std::vector<size_t> newSampleChainIds;
+            for (auto &&chainId : sampleChainIds)
+            {
+                if (bits.Get(chainId))
+                    newSampleChainIds.push_back(chainId);
+            }
+            sampleChainIds = newSampleChainIds;
+            return sampleChainIds;
+        }
+
         // Reset sampleChainIds to point to all chains.
         // Applying each filter strips down samples.
         // Run this to start fresh or when chains are changed.
         auto ResetSamples()
         {
+            areColumnsSet = false;
             sampleChainIds.clear();
 
             for (size_t id = 0; id < chains.size(); id++)
@@ -108,7 +161,7 @@ namespace ForceChain
             }
         }
 
-        Stat(const std::vector<std::vector<size_t>> &chains_, const std::vector<Particle> &particles_)
+        BasicStat(const std::vector<std::vector<size_t>> &chains_, const BasicParticles<Scalar> &particles_)
             : chains(chains_), particles(particles_)
         {
             ResetSamples();
@@ -179,6 +232,22 @@ namespace ForceChain
             return sampleChainIds.size();
         }
 
+        // All the lengths above at once, they are zero if there is
+        // no sample chain.
+        auto GetSummary()
+        {
+            ChainsSummary summary;
+            summary.chainsCount = GetChainsCount();
+            if (summary.chainsCount == 0)
+                return summary;
+
+            summary.minLength = GetMinChainLength();
+            summary.maxLength = GetMaxChainLength();
+            summary.averageLength = GetAverageChainLength();
+            summary.medianLength = GetMedianChainLength();
+            return summary;
+        }
+
         // Finds a regression plane passing the particles
         // of a chain and returns the normal of the plane.
         auto GetChainNormalVector(const std::vector<size_t> &chain)
@@ -191,7 +260,7 @@ namespace ForceChain
             for (size_t i = -1; auto &&particleId : chain)
             {
                 i++;
-                auto &particle = particles[particleId];
+                auto particle = particles[particleId];
                 xy(i, 0) = particle.position(0);
                 xy(i, 1) = particle.position(1);
                 z(i) = particle.position(2);
@@ -243,6 +312,8 @@ namespace ForceChain
             }
         }
     };
+
+    using Stat = BasicStat<double>;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,223 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYMMETRICEIGENSOLVER_H
+#define SYMMETRICEIGENSOLVER_H
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <cmath>
+#include <Eigen/Dense>
+#include "particle.h"
+#include "parallelFor.h"
+
+namespace ForceChain
+{
+    // Eigen values and vectors of many real symmetric 3x3 matrices at
+    // once, one row (lane) per matrix. Cyclic Jacobi rotations are
+    // applied to all lanes together as Eigen array operations, so the
+    // work runs in SIMD lanes and has no branches per matrix. Sweeps
+    // stop once the off diagonal entries of every lane vanish.
+    //
+    // Columns of matrices: a00 a11 a22 a01 a02 a12.
+    // After Compute, values are in ascending order and component i
+    // of the vector of value k is in vectors.col(3 * k + i).
+    template <typename Scalar>
+    class BasicSymmetricEigenSolver3
+    {
+        using Column = Eigen::Array<Scalar, Eigen::Dynamic, 1>;
+
+        // Column of entry (p,q), p != q.
+        static int OffDiagonal(int p, int q)
+        {
+            return p + q + 2;
+        }
+
+        // Rotates plane (p,q) of every lane so entry (p,q) becomes zero,
+        // r is the third index.
+        void Rotate(int p, int q, int r)
+        {
+            auto app = matrices.col(p);
+            auto aqq = matrices.col(q);
+            auto apq = matrices.col(OffDiagonal(p, q));
+            auto arp = matrices.col(OffDiagonal(r, p));
+            auto arq = matrices.col(OffDiagonal(r, q));
+
+            // The smaller root of t^2 + 2 theta t - 1 = 0, the tangent
+            // of the rotation angle. theta is capped so its square does
+            // not overflow, e.g. in float, t is about zero there anyway.
+            const Scalar maxTheta = std::sqrt(std::numeric_limits<Scalar>::max()) / 2;
+            Column theta = ((aqq - app) / (Scalar(2) * apq)).max(-maxTheta).min(maxTheta);
+            Column t = Scalar(1) / (theta.abs() + (theta.square() + Scalar(1)).sqrt());
+            t = (theta < 0).select(-t, t);
+            t = (apq == 0).select(Scalar(0), t);
+            Column c = Scalar(1) / (t.square() + Scalar(1)).sqrt();
+            Column s = t * c;
+
+            app -= t * apq;
+            aqq += t * apq;
+            apq = 0;
+
+            Column oldArp = arp;
+            arp = c * oldArp - s * arq;
+            arq = s * oldArp + c * arq;
+
+            for (int i = 0; i < 3; i++)
+            {
+                auto vp = vectors.col(3 * p + i);
+                auto vq = vectors.col(3 * q + i);
+                Column oldVp = vp;
+                vp = c * oldVp - s * vq;
+                vq = s * oldVp + c * vq;
+            }
+        }
+
+        // Orders value columns i < j of every lane, with their vectors.
+        void Sort(int i, int j)
+        {
+            Eigen::Array<bool, Eigen::Dynamic, 1> isSwapped = values.col(j) < values.col(i);
+            Column lower = isSwapped.select(values.col(j), values.col(i));
+            values.col(j) = isSwapped.select(values.col(i), values.col(j));
+            values.col(i) = lower;
+            for (int k = 0; k < 3; k++)
+            {
+                Column lowerVector = isSwapped.select(vectors.col(3 * j + k), vectors.col(3 * i + k));
+                vectors.col(3 * j + k) = isSwapped.select(vectors.col(3 * i + k), vectors.col(3 * j + k));
+                vectors.col(3 * i + k) = lowerVector;
+            }
+        }
+
+    public:
+        // Quadratic convergence gets double precision in 4 to 6 sweeps,
+        // this only guards against NaN input.
+        static constexpr int maxSweeps = 20;
+
+        // Sweeps stop when the sum of squared off diagonal entries of
+        // the scaled lanes is below it, far under the round off of
+        // Scalar.
+        static constexpr Scalar offDiagonalTolerance = std::is_same_v<Scalar, float> ? Scalar(1e-22) : Scalar(1e-40);
+
+        Eigen::Array<Scalar, Eigen::Dynamic, 6> matrices;
+        Eigen::Array<Scalar, Eigen::Dynamic, 3> values;
+        Eigen::Array<Scalar, Eigen::Dynamic, 9> vectors;
+
+        void Resize(Eigen::Index count)
+        {
+            matrices.resize(count, 6);
+        }
+
+        void Compute()
+        {
+            auto count = matrices.rows();
+
+            // Entries are scaled to at most 1, so the convergence test
+            // below is relative and nothing overflows.
+            Column scale = matrices.abs().rowwise().maxCoeff();
+            scale = (scale == 0).select(Scalar(1), scale);
+            for (int k = 0; k < 6; k++)
+                matrices.col(k) /= scale;
+
+            vectors.setZero(count, 9);
+            for (int k = 0; k < 3; k++)
+                vectors.col(4 * k).setOnes();
+
+            for (int sweep = 0; sweep < maxSweeps; sweep++)
+            {
+                auto offDiagonal = matrices.template rightCols<3>().square().rowwise().sum();
+                if (count == 0 || offDiagonal.maxCoeff() < offDiagonalTolerance)
+                    break;
+
+                Rotate(0, 1, 2);
+                Rotate(0, 2, 1);
+                Rotate(1, 2, 0);
+            }
+
+            values.resize(count, 3);
+            for (int k = 0; k < 3; k++)
+                values.col(k) = matrices.col(k) * scale;
+
+            Sort(0, 1);
+            Sort(1, 2);
+            Sort(0, 1);
+        }
+    };
+
+    using SymmetricEigenSolver3 = BasicSymmetricEigenSolver3<double>;
+
+    // Same as setPrincipleStressAndDir of particles ids[0..count),
+    // where ids(k) gives the k-th id, but for the symmetric part of
+    // stress, (stress + stress^T) / 2, solved by SymmetricEigenSolver3
+    // in blocks of particles. All the principle stresses are real,
+    // directions are orthonormal and sorted from minor to major.
+    // threadsCount = 0 uses all cores.
+    // The matrices are solved in the Scalar of particles.
+    template <typename Scalar, typename Ids>
+    void SetSymmetricPrincipleStresses(BasicParticles<Scalar> &particles, size_t count, Ids ids,
+                                       size_t threadsCount = 1)
+    {
+        const size_t blockSize = 256;
+        if (threadsCount == 0)
+            threadsCount = DefaultThreadsCount();
+        threadsCount = std::max<size_t>(1, std::min(threadsCount, count / blockSize + 1));
+
+        ParallelFor(threadsCount, [&](size_t iThread)
+                    {
+            auto first = count * iThread / threadsCount;
+            auto last = count * (iThread + 1) / threadsCount;
+            BasicSymmetricEigenSolver3<Scalar> solver;
+
+            for (auto blockBegin = first; blockBegin < last; blockBegin += blockSize)
+            {
+                auto blockCount = std::min(blockSize, last - blockBegin);
+                solver.Resize(blockCount);
+                for (size_t k = 0; k < blockCount; k++)
+                {
+                    auto &stress = particles.cold[ids(blockBegin + k)].stress;
+                    solver.matrices.row(k) << stress(0, 0), stress(1, 1), stress(2, 2),
+                        (stress(0, 1) + stress(1, 0)) / 2,
+                        (stress(0, 2) + stress(2, 0)) / 2,
+                        (stress(1, 2) + stress(2, 1)) / 2;
+                }
+
+                solver.Compute();
+
+                for (size_t k = 0; k < blockCount; k++)
+                {
+                    typename BasicParticle<Scalar>::Vector3 values = solver.values.row(k).transpose();
+                    typename BasicParticle<Scalar>::Matrix3 dirs = BasicParticle<Scalar>::Matrix3::Map(solver.vectors.row(k).eval().data());
+                    particles[ids(blockBegin + k)].setPrincipleStressAndDir(values, dirs);
+                }
+            } });
+    }
+
+    // The same for all particles.
+    template <typename Scalar>
+    void SetSymmetricPrincipleStresses(BasicParticles<Scalar> &particles, size_t threadsCount = 1)
+    {
+        SetSymmetricPrincipleStresses(particles, particles.size(), [](size_t k)
+                                      { return k; }, threadsCount);
+    }
+}
+
+#endif // SYMMETRICEIGENSOLVER_H
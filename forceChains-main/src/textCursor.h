@@ -0,0 +1,152 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEXTCURSOR_H
+#define TEXTCURSOR_H
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+namespace ForceChain
+{
+    // A light cursor over a text buffer that reads numbers in place
+    // with std::from_chars. It never allocates, so it is used by the
+    // readers in their per-line hot loops.
+    // Read functions return false when a number cannot be parsed.
+    class TextCursor
+    {
+        const char *pos;
+        const char *end;
+
+    public:
+        TextCursor(std::string_view text)
+            : pos(text.data()), end(text.data() + text.size()) {}
+
+        bool AtEnd() const
+        {
+            return pos >= end;
+        }
+
+        const char *Position() const
+        {
+            return pos;
+        }
+
+        // Skips spaces and tabs but not the end of line.
+        void SkipBlanks()
+        {
+            while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+                pos++;
+        }
+
+        // Moves to the first character of the next line.
+        void SkipLine()
+        {
+            while (pos < end && *pos != '\n')
+                pos++;
+            if (pos < end)
+                pos++;
+        }
+
+        // Returns the rest of current line without the end of line
+        // characters and moves to the next line.
+        std::string_view ReadLine()
+        {
+            auto begin = pos;
+            while (pos < end && *pos != '\n')
+                pos++;
+            auto lineEnd = pos;
+            if (lineEnd > begin && *(lineEnd - 1) == '\r')
+                lineEnd--;
+            if (pos < end)
+                pos++;
+            return std::string_view(begin, lineEnd - begin);
+        }
+
+        // True if only blanks are left in the current line.
+        bool AtEndOfLine()
+        {
+            SkipBlanks();
+            return pos >= end || *pos == '\n';
+        }
+
+        bool ReadDouble(double &value)
+        {
+            SkipBlanks();
+            auto [ptr, ec] = std::from_chars(pos, end, value);
+            if (ec != std::errc())
+                return false;
+            pos = ptr;
+            return true;
+        }
+
+        template <typename Integer>
+        bool ReadInteger(Integer &value)
+        {
+            SkipBlanks();
+            // from_chars does not accept a leading plus sign
+            if (pos < end && *pos == '+')
+                pos++;
+            auto [ptr, ec] = std::from_chars(pos, end, value);
+            if (ec != std::errc())
+                return false;
+            pos = ptr;
+            return true;
+        }
+
+        // Reads a 0/1 flag.
+        bool ReadBool(bool &value)
+        {
+            int flag;
+            if (!ReadInteger(flag))
+                return false;
+            value = flag;
+            return true;
+        }
+
+        // True if the text at cursor starts with prefix, the cursor
+        // does not move.
+        bool StartsWith(std::string_view prefix) const
+        {
+            return std::string_view(pos, end - pos).starts_with(prefix);
+        }
+
+        // Skips one whitespace separated token without parsing it.
+        void SkipToken()
+        {
+            SkipBlanks();
+            while (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n')
+                pos++;
+        }
+
+        std::string_view ReadToken()
+        {
+            SkipBlanks();
+            auto begin = pos;
+            SkipToken();
+            return std::string_view(begin, pos - begin);
+        }
+    };
+}
+
+#endif // TEXTCURSOR_H
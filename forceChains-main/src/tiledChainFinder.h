@@ -0,0 +1,900 @@
+/* 
+# Force Chain Finder - A software tool for the recursive detection of
+# force-chains in granular materials via minor principal stress.
+# Copyright (C) 2023 Omid Ejtehadi 'oejtehad@ed.ac.uk'
+#		             Aashish K Gupta 'A.K.Gupta-2@sms.ed.ac.uk'
+#		             Sorush Khajepor 'sorush.kh@gmail.com'
+#		             Sina Haeri 'shaeri@ed.ac.uk'
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEDCHAINFINDER_H
+#define TILEDCHAINFINDER_H
+
+#include <vector>
+#include <string>
+#include <array>
+#include <limits>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <stdexcept>
+#include <Eigen/Dense>
+#include "liggghtsReader.h"
+#include "particleIdMap.h"
+#include "contactGraph.h"
+#include "symmetricEigenSolver.h"
+#include "chainFinder.h"
+#include "parallelFor.h"
+#include "mappedFile.h"
+#include "byteReader.h"
+#include "chainsIo.h"
+#include "stat.h"
+
+namespace ForceChain
+{
+    /*
+    Finds the chains of a frame too big to be analysed at once, as
+    UserInterface does, one spatial tile at a time.
+
+    Only id, type, position, radius and minor direction of every
+    particle are kept in memory, with its tile and component, about
+    100 bytes each, see GetResidentBytesPerParticle. The bounding box
+    of the particles is split into a grid of tiles, as few as fit
+    memoryBudget with these, see PlanTiles. For each tile the pair
+    file is read again, keeping the contacts of its particles, its
+    core, and of the particles of other tiles touching them, its halo.
+    Stresses of core and halo are then those of the whole frame, so the
+    edges of the core that pass the angle checks are found as by
+    UserInterface. The core particles with minor stress are spilled to
+    spillFile, stresses, principle stresses and edges, and the edges
+    are joined into components on the way.
+
+    Chains are then searched by component, which may span tiles, as
+    BasicChainFinder does with threads, each component reading its
+    edges back from the spill. chains, chainIds and linkNodes are the
+    same as of UserInterface, and so are the files written, which read
+    the particles of the chains from the spill one at a time. With
+    symmetricStress the particles solved together differ, so stresses
+    may differ in their last digits.
+    */
+    template <typename Scalar>
+    class BasicTiledChainFinder
+    {
+        using Particle = BasicParticle<Scalar>;
+        using Vector3 = typename Particle::Vector3;
+
+        // Marks a particle that is not in the tile or component at hand.
+        static constexpr uint32_t none = UINT32_MAX;
+        // Marks a particle that has nothing in the spill.
+        static constexpr uint64_t notSpilled = UINT64_MAX;
+
+        std::string particlesFile;
+        std::string pairFile;
+        std::string wallFile;
+        double chainMaxAngle;
+
+        // Particles of the frame ordered by id, as by ReadParticles.
+        std::vector<size_t> ids;
+        std::vector<size_t> types;
+        std::vector<Vector3> positions;
+        std::vector<Scalar> radii;
+        ParticleIdMap idMap;
+
+        // Tile of each particle. Row t of cores lists the particles of
+        // tile t in ascending order, of halos the particles of other
+        // tiles touching them. Freed once the tiles are read.
+        std::vector<uint32_t> tileIds;
+        CsrRows<uint32_t> cores;
+        CsrRows<uint32_t> halos;
+
+        // Minor direction of each particle, flipped by the search.
+        std::vector<Vector3> minorDirs;
+
+        // Where each particle with minor stress is in the spill.
+        std::vector<uint64_t> spillOffsets;
+
+        // Union find of the particles joined by edges, the root of a
+        // set is its first particle.
+        std::vector<uint32_t> parents;
+
+        // Index of each particle in the tile or component at hand.
+        std::vector<uint32_t> localIds;
+
+        // An edge from a particle with minor stress that passes the
+        // angle checks, to a neighbor with minor stress.
+        struct Edge
+        {
+            uint32_t neighbor;
+            Scalar cosForward;
+            Scalar cosBackward;
+        };
+        size_t edgesCount = 0;
+
+        // What is spilled of a particle, field by field: force, stress,
+        // principle directions and stresses, minor stress, whether the
+        // principle stresses are solved and the count of its edges,
+        // then its edges, in the order of its ContactGraph row.
+        static constexpr size_t recordBytes = (3 + 9 + 2 * 9 + 2 * 3 + 1) * sizeof(Scalar) +
+                                              sizeof(uint8_t) + sizeof(uint32_t);
+        static constexpr size_t edgeBytes = sizeof(uint32_t) + 2 * sizeof(Scalar);
+
+        // Removes its file when destroyed, so an exception leaves no
+        // spill behind. Moving it moves the file.
+        class SpillFile
+        {
+        public:
+            std::string name;
+
+            SpillFile() = default;
+            explicit SpillFile(std::string name_) : name(name_) {}
+            SpillFile(SpillFile &&other) noexcept : name(std::exchange(other.name, "")) {}
+            SpillFile &operator=(SpillFile &&other) noexcept
+            {
+                Remove();
+                name = std::exchange(other.name, "");
+                return *this;
+            }
+            ~SpillFile()
+            {
+                Remove();
+            }
+
+            void Remove()
+            {
+                std::error_code error;
+                if (!name.empty())
+                    std::filesystem::remove(name, error);
+                name.clear();
+            }
+        };
+        // The spill of the last Run, read by the outputs.
+        SpillFile spill;
+
+        // Chains of a component as indices of the frame particles, and
+        // the linkNodes of their particles, a CsrRows per chain.
+        struct ComponentChains
+        {
+            std::vector<std::vector<size_t>> chains;
+            std::vector<CsrRows<int64_t>> linkNodes;
+        };
+
+        // The particle of each item of particleIds in the frame, and
+        // its chain.
+        std::vector<uint32_t> members;
+        std::vector<mint> memberChainIds;
+
+    public:
+        // LIGGGHTS ids of the particles of the chains, in ascending
+        // order. Items of chains are indices of it.
+        std::vector<size_t> particleIds;
+        std::vector<std::vector<double>> simulation_box;
+        std::vector<std::vector<size_t>> chains;
+
+        // linkNodes of particleIds, see ChainLinks. isLinked is empty,
+        // as there is no graph of all the particles.
+        ChainLinks links;
+
+        // Bytes the particles and a tile with its core and halo may
+        // take, see PlanTiles. It is a target, tiles are not made
+        // thinner than a particle, and a component is searched whole.
+        size_t memoryBudget = size_t(1) << 30;
+
+        // Pair contacts per particle assumed by PlanTiles.
+        double contactsPerParticle = 4;
+
+        // As of UserInterface, principle stresses are of the
+        // symmetric part of stress.
+        bool symmetricStress = false;
+
+        // Threads used to sum stresses, flag edges and search the
+        // components, 0 uses all cores.
+        size_t threadsCount = 0;
+
+        // If true, tiles and components are reported on terminal.
+        bool verbose = false;
+
+        // Where the core particles are kept, by default next to the
+        // pair file. The outputs read it, it is removed by the next
+        // Run or with the finder.
+        std::string spillFile;
+
+        BasicTiledChainFinder(std::string particlesFile_, std::string pairFile_,
+                              std::string wallFile_, double chainMaxAngle_)
+            : particlesFile(particlesFile_), pairFile(pairFile_), wallFile(wallFile_),
+              chainMaxAngle(chainMaxAngle_)
+        {
+        }
+
+        // Reads the particles file once and the pair file twice plus
+        // once per tile, and finds the chains.
+        void Run()
+        {
+            spill.Remove();
+            ReadParticles();
+            PlanTiles();
+            SetHalos();
+
+            SpillFile tilesSpill(spillFile.empty() ? pairFile + ".tiles" : spillFile);
+            {
+                std::ofstream stream(tilesSpill.name, std::ios::binary);
+                if (!stream)
+                    throw std::runtime_error("\n Error: Cannot write the below file:\n" + tilesSpill.name);
+
+                spillOffsets.assign(ids.size(), notSpilled);
+                parents.resize(ids.size());
+                std::iota(parents.begin(), parents.end(), 0);
+                edgesCount = 0;
+                uint64_t spillSize = 0;
+                for (size_t tile = 0; tile < cores.RowsCount(); tile++)
+                {
+                    if (cores.GetRow(tile).size() > 0)
+                        ReadTile(tile, stream, spillSize);
+                }
+                if (!stream.flush())
+                    throw std::runtime_error("\n Error: Cannot write the below file:\n" + tilesSpill.name);
+            }
+            tileIds.clear();
+            tileIds.shrink_to_fit();
+            cores = CsrRows<uint32_t>();
+            halos = CsrRows<uint32_t>();
+
+            auto found = FindChainsOfComponents(tilesSpill.name);
+            SetChains(found);
+            spill = std::move(tilesSpill);
+        }
+
+    protected:
+        template <typename T>
+        static void Write(std::ofstream &stream, const T *values, size_t count)
+        {
+            stream.write(reinterpret_cast<const char *>(values), count * sizeof(T));
+        }
+
+        template <typename T>
+        static void Write(std::ofstream &stream, const T &value)
+        {
+            Write(stream, &value, 1);
+        }
+
+        // Reads id, type, position and radius of the particles.
+        void ReadParticles()
+        {
+            ids.clear();
+            types.clear();
+            positions.clear();
+            radii.clear();
+            ReadParticleFileRows(particlesFile, [&](size_t id, size_t type, const Eigen::Vector3d &position, double radius)
+                                 {
+                ids.push_back(id);
+                types.push_back(type);
+                positions.push_back(position.template cast<Scalar>());
+                radii.push_back(radius); });
+
+            // (id, index), as SortParticlesById.
+            std::vector<std::pair<size_t, size_t>> order(ids.size());
+            for (size_t i = 0; i < ids.size(); i++)
+                order[i] = {ids[i], i};
+            if (!std::is_sorted(order.begin(), order.end()))
+            {
+                std::sort(order.begin(), order.end());
+                auto reorder = [&](auto &values)
+                {
+                    std::remove_reference_t<decltype(values)> sorted(values.size());
+                    for (size_t i = 0; i < values.size(); i++)
+                        sorted[i] = values[order[i].second];
+                    values = std::move(sorted);
+                };
+                reorder(ids);
+                reorder(types);
+                reorder(positions);
+                reorder(radii);
+            }
+
+            for (size_t i = 1; i < ids.size(); i++)
+            {
+                if (ids[i] == ids[i - 1])
+                    throw std::runtime_error("\n Error: The particle id " + std::to_string(ids[i]) +
+                                             " is repeated in the below input:\n" + particlesFile);
+            }
+
+            idMap = ParticleIdMap(ids);
+            minorDirs.assign(ids.size(), Vector3::Zero());
+            localIds.assign(ids.size(), none);
+        }
+
+        // Bytes kept of every particle while the tiles are read and the
+        // components searched: id, type, position, radius and minor
+        // direction, tile, local index, union find parent, spill offset,
+        // its place in cores and in its component, and the halo items
+        // of its contacts, as counted by SetHalos.
+        double GetResidentBytesPerParticle() const
+        {
+            auto bytes = 2 * sizeof(size_t) + 7 * sizeof(Scalar) + 5 * sizeof(uint32_t) + sizeof(uint64_t);
+            return bytes + 2 * contactsPerParticle * sizeof(uint32_t);
+        }
+
+        // Bytes of a particle of a tile with its contacts, in the table
+        // and the graph with the cosines of their edges.
+        double GetBytesPerParticle() const
+        {
+            auto contactBytes = 2 * sizeof(int) + 7 * sizeof(double) + 2 * (sizeof(uint32_t) + 2 * sizeof(Scalar));
+            return BasicParticles<Scalar>::bytesPerParticle + sizeof(uint32_t) + contactsPerParticle * contactBytes;
+        }
+
+        // Tile of each particle in a grid of divisions over [low, high].
+        void SetTileIds(const Eigen::Vector3d &low, const Eigen::Vector3d &high,
+                        const std::array<size_t, 3> &divisions)
+        {
+            tileIds.resize(ids.size());
+            for (size_t i = 0; i < ids.size(); i++)
+            {
+                size_t tile = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    auto side = (high[k] - low[k]) / divisions[k];
+                    size_t cell = side > 0 ? size_t((positions[i][k] - low[k]) / side) : 0;
+                    tile = tile * divisions[k] + std::min(cell, divisions[k] - 1);
+                }
+                tileIds[i] = tile;
+            }
+        }
+
+        // Splits the bounding box of the particles into a grid of
+        // tiles, halving the longest side of the tiles until the
+        // largest tile, with a halo as big as itself, fits what
+        // memoryBudget leaves of the state kept of all the particles.
+        void PlanTiles()
+        {
+            double residentBytes = ids.size() * GetResidentBytesPerParticle() + idMap.GetBytes();
+            if (residentBytes >= memoryBudget)
+                throw std::runtime_error("\n Error: memoryBudget is below the " + std::to_string(size_t(residentBytes)) +
+                                         " bytes kept of the particles of the below file:\n" + particlesFile);
+            auto tileBudget = memoryBudget - residentBytes;
+
+            Eigen::Vector3d low = Eigen::Vector3d::Constant(std::numeric_limits<double>::max());
+            Eigen::Vector3d high = -low;
+            double maxRadius = 0;
+            for (size_t i = 0; i < ids.size(); i++)
+            {
+                low = low.cwiseMin(positions[i].template cast<double>());
+                high = high.cwiseMax(positions[i].template cast<double>());
+                maxRadius = std::max<double>(maxRadius, radii[i]);
+            }
+
+            std::array<size_t, 3> divisions{1, 1, 1};
+            std::vector<size_t> counts;
+            while (true)
+            {
+                SetTileIds(low, high, divisions);
+                counts.assign(divisions[0] * divisions[1] * divisions[2], 0);
+                for (auto tile : tileIds)
+                    counts[tile]++;
+
+                auto largest = *std::max_element(counts.begin(), counts.end());
+                if (2 * largest * GetBytesPerParticle() <= tileBudget)
+                    break;
+
+                int axis = 0;
+                for (int k = 1; k < 3; k++)
+                {
+                    if ((high[k] - low[k]) / divisions[k] > (high[axis] - low[axis]) / divisions[axis])
+                        axis = k;
+                }
+                if ((high[axis] - low[axis]) / divisions[axis] / 2 < 2 * maxRadius)
+                    break;
+                divisions[axis] *= 2;
+            }
+
+            if (verbose)
+                std::cout << counts.size() << " tiles, " << size_t(residentBytes) << " bytes kept of "
+                          << ids.size() << " particles\n";
+
+            cores.offsets.assign(counts.size() + 1, 0);
+            for (size_t tile = 0; tile < counts.size(); tile++)
+                cores.offsets[tile + 1] = cores.offsets[tile] + counts[tile];
+            cores.values.resize(ids.size());
+            std::vector<size_t> next(cores.offsets.begin(), cores.offsets.end() - 1);
+            for (size_t i = 0; i < ids.size(); i++)
+                cores.values[next[tileIds[i]]++] = i;
+        }
+
+        // Reads the pair file twice, to count then to list the
+        // particles of other tiles touching each tile, so no list but
+        // halos is kept, and the simulation box.
+        void SetHalos()
+        {
+            // Calls onItem(tile, particle of another tile touching it)
+            // for both ends of every contact between tiles.
+            auto forEachItem = [&](auto onItem)
+            {
+                return ReadPairFileRows(pairFile, [&](int64_t id1, int64_t id2, const Eigen::Vector3d &, const Eigen::Vector3d &, const Eigen::Vector3d &, double)
+                                        {
+                    int index1, index2;
+                    if (!FindParticleIndices(idMap, id1, id2, index1, index2) || tileIds[index1] == tileIds[index2])
+                        return;
+                    onItem(tileIds[index1], uint32_t(index2));
+                    onItem(tileIds[index2], uint32_t(index1)); });
+            };
+
+            halos.offsets.assign(cores.offsets.size(), 0);
+            simulation_box = forEachItem([&](uint32_t tile, uint32_t)
+                                         { halos.offsets[tile + 1]++; });
+            std::partial_sum(halos.offsets.begin(), halos.offsets.end(), halos.offsets.begin());
+
+            halos.values.resize(halos.offsets.back());
+            std::vector<size_t> next(halos.offsets.begin(), halos.offsets.end() - 1);
+            forEachItem([&](uint32_t tile, uint32_t i)
+                        { halos.values[next[tile]++] = i; });
+
+            // Rows sorted without repeats, moved to the front.
+            size_t kept = 0;
+            for (size_t tile = 0; tile < halos.RowsCount(); tile++)
+            {
+                auto first = halos.values.begin() + halos.offsets[tile];
+                auto last = halos.values.begin() + halos.offsets[tile + 1];
+                std::sort(first, last);
+                last = std::unique(first, last);
+                halos.offsets[tile] = kept;
+                kept = std::copy(first, last, halos.values.begin() + kept) - halos.values.begin();
+            }
+            halos.offsets.back() = kept;
+            halos.values.resize(kept);
+            halos.values.shrink_to_fit();
+        }
+
+        uint32_t FindRoot(uint32_t i)
+        {
+            while (parents[i] != i)
+            {
+                parents[i] = parents[parents[i]];
+                i = parents[i];
+            }
+            return i;
+        }
+
+        void Unite(uint32_t a, uint32_t b)
+        {
+            a = FindRoot(a);
+            b = FindRoot(b);
+            if (a != b)
+                parents[std::max(a, b)] = std::min(a, b);
+        }
+
+        // Reads the contacts of the core and halo of tile, which adds
+        // the particles they touch, whose stresses are not complete and
+        // are not solved. Keeps minor directions of the core, spills
+        // the core particles with minor stress with their edges, and
+        // joins the edges into components.
+        void ReadTile(size_t tile, std::ofstream &stream, uint64_t &spillSize)
+        {
+            BasicParticles<Scalar> tileParticles;
+            // Index of each particle of the tile in the frame.
+            std::vector<uint32_t> indices;
+            auto add = [&](uint32_t i)
+            {
+                if (localIds[i] == none)
+                {
+                    localIds[i] = tileParticles.size();
+                    indices.push_back(i);
+                    auto particle = tileParticles.emplace_back();
+                    particle.id = ids[i];
+                    particle.type = types[i];
+                    particle.position = positions[i];
+                    particle.radius = radii[i];
+                }
+                return int(localIds[i]);
+            };
+
+            for (auto i : cores.GetRow(tile))
+                add(i);
+            auto coreCount = tileParticles.size();
+            for (auto i : halos.GetRow(tile))
+                add(i);
+            auto solvedCount = tileParticles.size();
+            auto isSolved = [&](size_t i)
+            { return localIds[i] < solvedCount; };
+
+            // Contacts in the order of the file, so stresses are summed
+            // as by UserInterface.
+            ContactTable contacts, wallContacts;
+            auto &low_bound = simulation_box[0];
+            auto &upp_bound = simulation_box[1];
+            ReadPairFileRows(pairFile, [&](int64_t id1, int64_t id2, const Eigen::Vector3d &x1, const Eigen::Vector3d &x2, const Eigen::Vector3d &f12, double overlap)
+                             {
+                auto index1 = idMap.Find(id1);
+                auto index2 = idMap.Find(id2);
+                if (index1 == ParticleIdMap::missing || index2 == ParticleIdMap::missing ||
+                    (!isSolved(index1) && !isSolved(index2)))
+                    return;
+                auto local1 = add(index1);
+                auto local2 = add(index2);
+                contacts.Add(MakePairContact(tileParticles, local1, local2, x1, x2, f12, overlap, low_bound, upp_bound)); });
+
+            if (IsWallFile(wallFile))
+            {
+                ReadWallFileRows(wallFile, [&](int64_t pid, const Eigen::Vector3d &x1, const Eigen::Vector3d &x2, const Eigen::Vector3d &f12, double overlap)
+                                 {
+                    auto index = idMap.Find(pid);
+                    if (index != ParticleIdMap::missing && isSolved(index))
+                        wallContacts.Add(MakeWallContact(localIds[index], x1, x2, f12, overlap)); });
+            }
+
+            ResetStressAndForce(tileParticles);
+            AddContacts(tileParticles, contacts, threadsCount);
+            AddContacts(tileParticles, wallContacts, threadsCount);
+            if (symmetricStress)
+                SetSymmetricPrincipleStresses(tileParticles, solvedCount, [](size_t k)
+                                              { return k; }, threadsCount);
+            else
+            {
+                for (size_t k = 0; k < solvedCount; k++)
+                    tileParticles[k].setPrincipleStressAndDir();
+            }
+
+            ContactGraph graph;
+            BuildContactGraph(tileParticles.size(), contacts, graph, threadsCount);
+            EdgeCosines<Scalar> cosines;
+            BasicChainFinder<Scalar>{tileParticles, graph, chainMaxAngle, simulation_box, threadsCount}.SetEdgeCosines(cosines);
+
+            auto cosAlpha = Scalar(std::cos(chainMaxAngle));
+            std::vector<Edge> rowEdges;
+            for (size_t k = 0; k < coreCount; k++)
+            {
+                auto particle = tileParticles[k];
+                auto i = indices[k];
+                minorDirs[i] = particle.minorDir;
+                if (!particle.hasMinorStress)
+                    continue;
+
+                rowEdges.clear();
+                for (auto edge = graph.offsets[k]; edge < graph.offsets[k + 1]; edge++)
+                {
+                    auto inei = graph.values[edge];
+                    if (tileParticles[inei].hasMinorStress &&
+                        BasicChainFinder<Scalar>::IsEligibleEdge(cosines.forward[edge], cosines.backward[edge], cosAlpha))
+                    {
+                        rowEdges.push_back({indices[inei], cosines.forward[edge], cosines.backward[edge]});
+                        Unite(i, indices[inei]);
+                    }
+                }
+                edgesCount += rowEdges.size();
+
+                spillOffsets[i] = spillSize;
+                spillSize += WriteSpilled(stream, particle, rowEdges);
+            }
+
+            if (verbose)
+                std::cout << "Tile " << tile << ": " << coreCount << " core, " << solvedCount - coreCount
+                          << " halo, " << tileParticles.size() - solvedCount << " touching particles, "
+                          << contacts.Size() << " contacts\n";
+
+            for (auto i : indices)
+                localIds[i] = none;
+        }
+
+        // Writes particle and its edges to the spill, see recordBytes.
+        // Returns the bytes written.
+        static size_t WriteSpilled(std::ofstream &stream, const Particle &particle, const std::vector<Edge> &rowEdges)
+        {
+            Write(stream, particle.force.data(), 3);
+            Write(stream, particle.stress.data(), 9);
+            Write(stream, particle.principleDirs.data(), 9);
+            Write(stream, particle.principleStresses.data(), 3);
+            Write(stream, particle.minorStress);
+            Write(stream, uint8_t(particle.arePrincipleStressesSolved));
+            Write(stream, uint32_t(rowEdges.size()));
+            for (auto &edge : rowEdges)
+            {
+                Write(stream, edge.neighbor);
+                Write(stream, edge.cosForward);
+                Write(stream, edge.cosBackward);
+            }
+            return recordBytes + rowEdges.size() * edgeBytes;
+        }
+
+        // Reads what WriteSpilled wrote of particle, apart from edges.
+        static bool ReadSpilled(ByteReader &reader, Particle particle)
+        {
+            uint8_t isSolved;
+            uint32_t count;
+            if (!reader.Read(particle.force.data(), 3) || !reader.Read(particle.stress.data(), 9) ||
+                !reader.Read(particle.principleDirs.data(), 9) || !reader.Read(particle.principleStresses.data(), 3) ||
+                !reader.Read(particle.minorStress) || !reader.Read(isSolved) || !reader.Read(count))
+                return false;
+            particle.arePrincipleStressesSolved = isSolved;
+            particle.hasMinorStress = true;
+            return true;
+        }
+
+        // Reads the edges WriteSpilled wrote after a particle.
+        static bool ReadSpilledEdges(ByteReader &reader, std::vector<Edge> &rowEdges)
+        {
+            uint32_t count;
+            if (!reader.Skip(recordBytes - sizeof(uint32_t)) || !reader.Read(count))
+                return false;
+            rowEdges.resize(count);
+            for (auto &edge : rowEdges)
+            {
+                if (!reader.Read(edge.neighbor) || !reader.Read(edge.cosForward) || !reader.Read(edge.cosBackward))
+                    return false;
+            }
+            return true;
+        }
+
+        // Rows of the components of particles joined by edges, in
+        // either direction, of 3 particles or more, as a chain has. A
+        // component lists its particles in ascending order. parents
+        // are freed.
+        auto GetComponents()
+        {
+            auto count = ids.size();
+
+            // Roots come before the rest of their sets, so the parent of
+            // a particle is a root once the ones before it are.
+            std::vector<uint32_t> sizes(count, 0);
+            for (size_t i = 0; i < count; i++)
+            {
+                parents[i] = parents[parents[i]];
+                sizes[parents[i]]++;
+            }
+
+            CsrRows<uint32_t> components;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (parents[i] != i || sizes[i] < 3)
+                    sizes[i] = none;
+                else
+                {
+                    components.offsets.push_back(components.offsets.back() + sizes[i]);
+                    sizes[i] = components.RowsCount() - 1;
+                }
+            }
+
+            components.values.resize(components.offsets.back());
+            std::vector<size_t> next(components.offsets.begin(), components.offsets.end() - 1);
+            for (size_t i = 0; i < count; i++)
+            {
+                auto row = sizes[parents[i]];
+                if (row != none)
+                    components.values[next[row]++] = i;
+            }
+            parents.clear();
+            parents.shrink_to_fit();
+            return components;
+        }
+
+        // Searches the chains of component by BasicChainFinder, on its
+        // particles and its edges read from bytes of the spill only.
+        // Components have no particle in common, so they may be
+        // searched at once.
+        void FindChainsOfComponent(CsrRows<uint32_t>::Row component, ComponentChains &found,
+                                   std::string_view bytes, const std::string &spillName)
+        {
+            BasicParticles<Scalar> componentParticles;
+            componentParticles.resize(component.size());
+            for (size_t k = 0; k < component.size(); k++)
+            {
+                auto i = component[k];
+                localIds[i] = k;
+                auto particle = componentParticles[k];
+                particle.id = ids[i];
+                particle.position = positions[i];
+                particle.radius = radii[i];
+                particle.hasMinorStress = true;
+                particle.minorDir = minorDirs[i];
+            }
+
+            ContactGraph graph;
+            EdgeCosines<Scalar> cosines;
+            std::vector<Edge> rowEdges;
+            for (auto i : component)
+            {
+                ByteReader reader(bytes.substr(spillOffsets[i]));
+                if (!ReadSpilledEdges(reader, rowEdges))
+                    throw std::runtime_error("\n Error: Cannot read the below file:\n" + spillName);
+                for (auto &edge : rowEdges)
+                {
+                    graph.values.push_back(localIds[edge.neighbor]);
+                    cosines.forward.push_back(edge.cosForward);
+                    cosines.backward.push_back(edge.cosBackward);
+                }
+                graph.offsets.push_back(graph.values.size());
+            }
+
+            BasicChainFinder<Scalar> chainFinder{componentParticles, graph, chainMaxAngle, simulation_box, 1};
+            chainFinder.edgeCosines = &cosines;
+            for (auto &chain : chainFinder.RecursiveFindChains())
+            {
+                auto &frameChain = found.chains.emplace_back();
+                auto &linkNodes = found.linkNodes.emplace_back();
+                for (auto k : chain)
+                {
+                    frameChain.push_back(component[k]);
+                    auto row = chainFinder.links.linkNodes.GetRow(k);
+                    linkNodes.values.insert(linkNodes.values.end(), row.begin(), row.end());
+                    linkNodes.offsets.push_back(linkNodes.values.size());
+                }
+            }
+
+            for (size_t k = 0; k < component.size(); k++)
+            {
+                minorDirs[component[k]] = componentParticles[k].minorDir;
+                localIds[component[k]] = none;
+            }
+        }
+
+        // Searches the components by threadsCount threads, each takes
+        // the next one not taken yet, the largest ones first.
+        auto FindChainsOfComponents(const std::string &spillName)
+        {
+            auto components = GetComponents();
+            std::vector<ComponentChains> found(components.RowsCount());
+
+            std::vector<uint32_t> order(components.RowsCount());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                      { return components.GetRow(a).size() > components.GetRow(b).size(); });
+
+            MappedFile spilled(spillName);
+            auto bytes = spilled.View();
+            auto count = threadsCount == 0 ? DefaultThreadsCount() : threadsCount;
+            count = std::max<size_t>(1, std::min(count, order.size()));
+            std::atomic<size_t> nextComponent{0};
+            ParallelFor(count, [&](size_t)
+                        {
+                for (auto k = nextComponent++; k < order.size(); k = nextComponent++)
+                    FindChainsOfComponent(components.GetRow(order[k]), found[order[k]], bytes, spillName); });
+
+            if (verbose)
+                std::cout << "Searched " << components.RowsCount() << " components of "
+                          << edgesCount << " eligible edges\n";
+            return found;
+        }
+
+        // Orders chains by their centers, their first particles, as
+        // BasicChainFinder does, over the particles of the chains
+        // ordered by id.
+        void SetChains(const std::vector<ComponentChains> &found)
+        {
+            // (center, component, chain of the component)
+            std::vector<std::array<size_t, 3>> order;
+            members.clear();
+            for (size_t iComponent = 0; iComponent < found.size(); iComponent++)
+            {
+                for (size_t iChain = 0; iChain < found[iComponent].chains.size(); iChain++)
+                {
+                    auto &chain = found[iComponent].chains[iChain];
+                    order.push_back({chain.front(), iComponent, iChain});
+                    members.insert(members.end(), chain.begin(), chain.end());
+                }
+            }
+            std::sort(order.begin(), order.end());
+            // A particle may be in more than one chain, the last one is its chain.
+            std::sort(members.begin(), members.end());
+            members.erase(std::unique(members.begin(), members.end()), members.end());
+
+            particleIds.resize(members.size());
+            for (size_t k = 0; k < members.size(); k++)
+            {
+                localIds[members[k]] = k;
+                particleIds[k] = ids[members[k]];
+            }
+
+            chains.clear();
+            memberChainIds.assign(members.size(), -1);
+            std::vector<CsrRows<int64_t>::Row> linkRows(members.size());
+            for (size_t chainId = 0; chainId < order.size(); chainId++)
+            {
+                auto &component = found[order[chainId][1]];
+                auto &frameChain = component.chains[order[chainId][2]];
+                auto &linkNodes = component.linkNodes[order[chainId][2]];
+                auto &chain = chains.emplace_back();
+                for (size_t m = 0; m < frameChain.size(); m++)
+                {
+                    auto k = localIds[frameChain[m]];
+                    chain.push_back(k);
+                    memberChainIds[k] = chainId;
+                    linkRows[k] = linkNodes.GetRow(m);
+                }
+            }
+
+            links.isLinked.clear();
+            links.linkNodes.Clear();
+            for (auto &row : linkRows)
+            {
+                links.linkNodes.values.insert(links.linkNodes.values.end(), row.begin(), row.end());
+                links.linkNodes.offsets.push_back(links.linkNodes.values.size());
+            }
+
+            for (auto i : members)
+                localIds[i] = none;
+        }
+
+        // Fills particle with item k of particleIds, from bytes of the
+        // spill and the fields kept of every particle.
+        void ReadChainParticle(std::string_view bytes, size_t k, Particle particle) const
+        {
+            auto i = members[k];
+            ByteReader reader(bytes.substr(spillOffsets[i]));
+            if (!ReadSpilled(reader, particle))
+                throw std::runtime_error("\n Error: Cannot read the below file:\n" + spill.name);
+            particle.id = ids[i];
+            particle.type = types[i];
+            particle.radius = radii[i];
+            particle.position = positions[i];
+            particle.chainId = memberChainIds[k];
+            particle.minorDir = minorDirs[i];
+        }
+
+    public:
+        // The particles of particleIds, e.g. for BasicStat. Unlike the
+        // outputs it holds all of them in memory.
+        auto ReadChainParticles() const
+        {
+            MappedFile spilled(spill.name);
+            BasicParticles<Scalar> particles;
+            particles.resize(members.size());
+            for (size_t k = 0; k < members.size(); k++)
+                ReadChainParticle(spilled.View(), k, particles[k]);
+            return particles;
+        }
+
+        // As BasicChainsIo::WriteCsv, the particles of the chains are
+        // read from the spill one at a time.
+        auto WriteChainsCsv(std::string fileName,
+                            bool withHeaders,
+                            std::string delimiter)
+        {
+            std::ofstream fileStream(fileName);
+            if (withHeaders)
+                BasicChainsIo<Scalar>::WriteCsvHeader(fileStream, delimiter);
+
+            MappedFile spilled(spill.name);
+            BasicParticles<Scalar> row;
+            row.resize(1);
+            for (size_t k = 0; k < members.size(); k++)
+            {
+                ReadChainParticle(spilled.View(), k, row[0]);
+                BasicChainsIo<Scalar>::WriteCsvRow(fileStream, row[0], links.linkNodes.GetRow(k), delimiter);
+            }
+            fileStream.close();
+        }
+
+        // As BasicChainsIo::WriteVtp, see WriteChainsCsv.
+        auto WriteChainsVtp(std::string fileName)
+        {
+            std::vector<size_t> allChainIds(chains.size());
+            std::iota(allChainIds.begin(), allChainIds.end(), 0);
+
+            MappedFile spilled(spill.name);
+            BasicParticles<Scalar> row;
+            row.resize(1);
+            BasicChainsIo<Scalar>::WriteVtpOf(fileName, chains, allChainIds, [&](size_t k)
+                                              {
+                ReadChainParticle(spilled.View(), k, row[0]);
+                return row[0]; });
+        }
+    };
+
+    using TiledChainFinder = BasicTiledChainFinder<double>;
+}
+
+#endif // TILEDCHAINFINDER_H
@@ -20,18 +20,32 @@
 # along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifndef USERINTERFACE_H
+#define USERINTERFACE_H
+
 #include "liggghtsReader.h"
+#include "parallelPairReader.h"
+#include "dumpFrames.h"
+#include "snapshotCache.h"
+#include "symmetricEigenSolver.h"
+#include "incrementalStress.h"
 #include "chainFinder.h"
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
 #include "chainsIo.h"
 #include "stat.h"
 
 namespace ForceChain
 {
     // A public interface for this library for users.
-    class UserInterface
+    // Scalar is the one of the particles, see BasicParticle. Contacts
+    // are read and their stresses summed in double for both.
+    template <typename Scalar>
+    class BasicUserInterface
     {
         std::string particlesFile;
         std::string pairFile;
@@ -39,19 +53,75 @@ namespace ForceChain
         // It usually is pi/4, the smaller angle, the particles must
         // be more aligned to form a chain.
         double chainMaxAngle;
+        // Empty if snapshots are not used.
+        std::string snapshotFile;
 
     public:
-        std::vector<Particle> particles;
+        BasicParticles<Scalar> particles;
         std::vector<std::vector<double>> simulation_box;
         std::vector<std::vector<size_t>> chains;
 
-        ChainsIo chainsIo;
-        Stat stat;
+        // Pair and wall contacts of the last frame read. They are empty
+        // if the frame came from a snapshot, which keeps stresses only.
+        ContactTable contacts;
+        ContactTable wallContacts;
+
+        // Neighbors of particles by their pair contacts, see
+        // ContactGraph. Snapshots keep it.
+        ContactGraph graph;
+
+        // Vectors of the edges of graph, with periodic images, found
+        // once per frame for every chain search, see EdgeBranches.
+        EdgeBranches<Scalar> edgeBranches;
+
+        // Linkages and linkNodes of the chains found, see ChainLinks.
+        ChainLinks links;
+
+        // Depth and visits of the last chain search.
+        ChainSearchStats chainSearchStats;
+
+        BasicChainsIo<Scalar> chainsIo;
+        BasicStat<Scalar> stat;
+
+        // If true, readers report their throughput on terminal.
+        bool verbose = false;
+
+        // Threads used to read pair files, sum contact stresses and
+        // find chains, 0 uses all cores.
+        size_t threadsCount = 0;
+
+        // If true, principle stresses are of the symmetric part of
+        // stress, solved for all particles at once by the batched
+        // Jacobi solver, see SetSymmetricPrincipleStresses. It is
+        // faster and all its principle stresses are real.
+        // Otherwise the general eigen solver of each particle is used.
+        bool symmetricStress = false;
+
+        // If true, only the minor principle stress and its direction
+        // are solved before finding chains. The other principle
+        // stresses and directions are solved when first read, e.g. by
+        // WriteChainsCsv, for the particles written only. It has no
+        // effect with symmetricStress.
+        bool lazyPrincipleStresses = false;
+
+        // If set, stresses are updated from the contacts that changed
+        // since the previous frame given to it, see IncrementalStress.
+        // RunFrames gives it frames in order. For batches of files the
+        // same object may be shared by the UserInterface of every
+        // file, as long as they are loaded in order, as BatchPipeline
+        // does.
+        std::shared_ptr<BasicIncrementalStress<Scalar>> incrementalStress;
+
+        // If set, chains are searched again only in the components of
+        // particles that changed since the previous frame given to it,
+        // see IncrementalChains. It may be shared as incrementalStress.
+        // It is not used by RunAlphas.
+        std::shared_ptr<BasicIncrementalChains<Scalar>> incrementalChains;
 
-        UserInterface(std::string particlesFile_, std::string pairFile_,
+        BasicUserInterface(std::string particlesFile_, std::string pairFile_,
                       std::string wallFile_, double chainMaxAngle_)
             : particlesFile(particlesFile_), pairFile(pairFile_), wallFile(wallFile_),
-              chainMaxAngle(chainMaxAngle_), chainsIo(chains, particles), stat(chains, particles)
+              chainMaxAngle(chainMaxAngle_), chainsIo(chains, particles, links), stat(chains, particles)
         {
         }
 
@@ -60,31 +130,284 @@ namespace ForceChain
             return stat;
         }
 
+        // Keeps a binary snapshot of the frame after stress analysis in
+        // cacheFile, by default next to the pair file. Later runs of
+        // the same files load it instead of reading and analysing them
+        // again. It is rebuilt when any input file changes.
+        auto EnableSnapshotCache(std::string cacheFile = "")
+        {
+            snapshotFile = cacheFile.empty() ? pairFile + ".snapshot" : cacheFile;
+        }
+
         auto Run()
         {
-            particles = ReadParticles(particlesFile);
-            simulation_box = ReadPair(particles, pairFile);
+            Load();
+            FindChains();
+        }
+
+        // The first half of Run, reads the files, or their snapshot,
+        // and computes the principle stresses. FindChains does the rest.
+        // They are apart so batches can read a frame while chains of
+        // another frame are found, see BatchPipeline.
+        void Load()
+        {
+            std::string analysis = symmetricStress ? "symmetric" : "general";
+            if (lazyPrincipleStresses && !symmetricStress)
+                analysis += " lazy";
+            if (std::is_same_v<Scalar, float>)
+                analysis += " float";
+            SnapshotCache snapshot(snapshotFile, {particlesFile, pairFile, wallFile}, analysis);
+            if (!snapshotFile.empty() && snapshot.Load(particles, graph, simulation_box))
+            {
+                SetEdgeBranches(particles, graph, simulation_box, edgeBranches, threadsCount);
+                if (verbose)
+                    std::cout << "Loaded snapshot " << snapshotFile << "\n";
+                if (incrementalStress)
+                    incrementalStress->Reset();
+                return;
+            }
+
+            particles = ReadParticles<Scalar>(particlesFile);
+            simulation_box = ReadPairContacts(particles, pairFile, contacts, threadsCount, verbose);
     
-            if (wallFile.find(".txt") != std::string::npos) {
-                ReadWall(particles, wallFile);
+            wallContacts.Clear();
+            if (IsWallFile(wallFile)) {
+                ReadWallContacts(particles, wallFile, wallContacts);
             }
 
-            for (auto &particle : particles)
+            BuildContactGraph(particles.size(), contacts, graph, threadsCount);
+            SetEdgeBranches(particles, graph, simulation_box, edgeBranches, threadsCount);
+            AnalyseStresses();
+
+            if (!snapshotFile.empty())
+                snapshot.Save(particles, graph, simulation_box);
+        }
+
+        // Same as Run for every alpha of alphas, but the files are read
+        // and stresses analysed once, and the cosines of the angle
+        // checks of contacts are found once, see EdgeCosines. For
+        // each alpha, in the given order, chainMaxAngle is set to it
+        // and particles, chains, links and stat are as after Run with
+        // it, then onAlpha(alpha) is called, where the chains can be
+        // written or studied, e.g. by GetStat().GetSummary().
+        template <typename Callback>
+        void RunAlphas(const std::vector<double> &alphas, Callback onAlpha)
+        {
+            Load();
+
+            // The search flips minor directions and sets chainIds,
+            // they are put back before every alpha.
+            std::vector<typename BasicParticle<Scalar>::Vector3> minorDirs(particles.size());
+            std::vector<mint> chainIds(particles.size());
+            for (size_t i = 0; i < particles.size(); i++)
             {
-                particle.setPrincipleStressAndDir();
+                minorDirs[i] = particles[i].minorDir;
+                chainIds[i] = particles[i].chainId;
+            }
+
+            EdgeCosines<Scalar> edgeCosines;
+            BasicChainFinder<Scalar> cosinesFinder{particles, graph, chainMaxAngle, simulation_box, threadsCount};
+            cosinesFinder.edgeBranches = &edgeBranches;
+            cosinesFinder.SetEdgeCosines(edgeCosines);
+
+            for (size_t iAlpha = 0; iAlpha < alphas.size(); iAlpha++)
+            {
+                if (iAlpha > 0)
+                {
+                    for (size_t i = 0; i < particles.size(); i++)
+                    {
+                        particles[i].minorDir = minorDirs[i];
+                        particles[i].chainId = chainIds[i];
+                    }
+                }
+
+                chainMaxAngle = alphas[iAlpha];
+                FindChains(&edgeCosines);
+                onAlpha(alphas[iAlpha]);
+            }
+        }
+
+        // Same as Run, but for one frame of multi-timestep dumps given
+        // as text, see DumpFrames. wallFrame can be empty.
+        auto RunFrame(std::string_view particlesFrame,
+                      std::string_view pairFrame,
+                      std::string_view wallFrame = {})
+        {
+            TextCursor particlesCursor(particlesFrame);
+            particles = ReadParticlesFrame<Scalar>(particlesCursor, particlesFile);
+
+            simulation_box = ReadPairContactsFrameParallel(particles, pairFrame, pairFile, contacts, threadsCount, verbose);
+
+            wallContacts.Clear();
+            if (!wallFrame.empty())
+            {
+                TextCursor wallCursor(wallFrame);
+                ReadWallContactsFrame(particles, wallCursor, wallFile, wallContacts);
             }
 
-            ChainFinder chainFinder{particles, chainMaxAngle, simulation_box};
+            BuildContactGraph(particles.size(), contacts, graph, threadsCount);
+            SetEdgeBranches(particles, graph, simulation_box, edgeBranches, threadsCount);
+            AnalyseStresses();
+            FindChains();
+        }
+
+        // Runs every frame of files that hold many "ITEM: TIMESTEP"
+        // blocks, one frame at a time, without splitting the files.
+        // After each frame onFrame(timestep) is called, where the chains
+        // of that frame can be written or studied.
+        // Frames are matched by their timesteps, a frame that is not in
+        // all the files is skipped.
+        template <typename Callback>
+        void RunFrames(Callback onFrame)
+        {
+            DumpFrames particlesFrames(particlesFile);
+            DumpFrames pairFrames(pairFile);
+            std::unique_ptr<DumpFrames> wallFrames;
+            if (IsWallFile(wallFile))
+                wallFrames = std::make_unique<DumpFrames>(wallFile);
+
+            std::string_view particlesFrame, pairFrame, wallFrame;
+            size_t particlesStep, pairStep, wallStep;
+
+            bool hasFrame = particlesFrames.Next(particlesFrame, particlesStep) &&
+                            pairFrames.Next(pairFrame, pairStep) &&
+                            (!wallFrames || wallFrames->Next(wallFrame, wallStep));
+            while (hasFrame)
+            {
+                auto step = std::max(particlesStep, pairStep);
+                if (wallFrames)
+                    step = std::max(step, wallStep);
+
+                if (particlesStep == step && pairStep == step && (!wallFrames || wallStep == step))
+                {
+                    RunFrame(particlesFrame, pairFrame, wallFrame);
+                    onFrame(step);
+                    hasFrame = particlesFrames.Next(particlesFrame, particlesStep) &&
+                               pairFrames.Next(pairFrame, pairStep) &&
+                               (!wallFrames || wallFrames->Next(wallFrame, wallStep));
+                    continue;
+                }
+
+                // Move the files behind to the same timestep
+                if (particlesStep < step)
+                    hasFrame = particlesFrames.Next(particlesFrame, particlesStep);
+                if (hasFrame && pairStep < step)
+                    hasFrame = pairFrames.Next(pairFrame, pairStep);
+                if (hasFrame && wallFrames && wallStep < step)
+                    hasFrame = wallFrames->Next(wallFrame, wallStep);
+            }
+        }
+
+        // Finds the chains of particles whose principle
+        // stresses are computed. If edgeCosines is set, the angles of
+        // contacts are taken from it, see RunAlphas.
+        void FindChains(const EdgeCosines<Scalar> *edgeCosines = nullptr)
+        {
+            BasicChainFinder<Scalar> chainFinder{particles, graph, chainMaxAngle, simulation_box, threadsCount};
+            chainFinder.edgeCosines = edgeCosines;
+            chainFinder.edgeBranches = &edgeBranches;
+            if (!edgeCosines)
+                chainFinder.incrementalChains = incrementalChains.get();
             chains = chainFinder.RecursiveFindChains();
+            links = std::move(chainFinder.links);
+            chainSearchStats = chainFinder.stats;
             stat.ResetSamples();
+
+            if (verbose)
+                std::cout << "Found " << chains.size() << " chains, searched " << chainSearchStats.visitsCount
+                          << " links, tested " << chainSearchStats.testsCount << " neighbors, max depth "
+                          << chainSearchStats.maxDepth << ", components " << chainSearchStats.componentsCount << "\n";
+            if (verbose && chainFinder.incrementalChains)
+                std::cout << "Searched chains of " << incrementalChains->GetSearchedCount() << " of "
+                          << particles.size() << " particles\n";
+        }
+
+    protected:
+        // Sums stresses of contacts and solves principle stresses,
+        // from scratch or, if set, by incrementalStress.
+        void AnalyseStresses()
+        {
+            if (!incrementalStress)
+            {
+                ComputeContactStresses();
+                ComputePrincipleStresses();
+                return;
+            }
+
+            auto &ids = incrementalStress->Update(particles, contacts, wallContacts, threadsCount);
+            ComputePrincipleStresses(ids);
+            incrementalStress->Remember(particles);
+
+            if (verbose)
+                std::cout << "Solved principle stresses of " << ids.size() << " of "
+                          << particles.size() << " particles\n";
+        }
+
+        // Sums forces and stresses of pair, then wall, contacts.
+        void ComputeContactStresses()
+        {
+            auto startTime = std::chrono::steady_clock::now();
+
+            ResetStressAndForce(particles);
+            AddContacts(particles, contacts, threadsCount);
+            AddContacts(particles, wallContacts, threadsCount);
+
+            if (verbose)
+            {
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+                auto contactsCount = contacts.Size() + wallContacts.Size();
+                std::cout << "Computed stresses of " << contactsCount << " contacts in "
+                          << elapsed.count() << " s (" << contactsCount / elapsed.count() << " contacts/s)\n";
+            }
+        }
+
+        // Solves principle stresses of particles ids only.
+        void ComputePrincipleStresses(const std::vector<size_t> &ids)
+        {
+            if (symmetricStress)
+            {
+                SetSymmetricPrincipleStresses(particles, ids.size(), [&](size_t k)
+                                              { return ids[k]; }, threadsCount);
+                return;
+            }
+
+            for (auto id : ids)
+            {
+                if (lazyPrincipleStresses)
+                    particles[id].setMinorStressAndDir();
+                else
+                    particles[id].setPrincipleStressAndDir();
+            }
+        }
+
+        void ComputePrincipleStresses()
+        {
+            if (symmetricStress)
+            {
+                SetSymmetricPrincipleStresses(particles, threadsCount);
+                return;
+            }
+
+            if (lazyPrincipleStresses)
+            {
+                for (auto particle : particles)
+                    particle.setMinorStressAndDir();
+                return;
+            }
+
+            for (auto particle : particles)
+            {
+                particle.setPrincipleStressAndDir();
+            }
         }
 
+    public:
         auto WriteBigStressChains(std::string fileName,
                                   double minMinorStress,
                                   bool withHeaders,
                                   std::string delimiter)
         {
-            auto filter = MinorStressGreaterFilter(minMinorStress);
+            auto filter = BasicMinorStressGreaterFilter<Scalar>(minMinorStress);
             auto chainIds = stat.ApplyFilterAny(filter);
             chainsIo.WriteFilteredCsv(fileName, withHeaders, delimiter, chainIds);
         }
@@ -106,4 +429,9 @@ namespace ForceChain
             chainsIo.WriteChainsOnTerminal();
         }
     };
-}
\ No newline at end of file
+
+    using UserInterface = BasicUserInterface<double>;
+    using UserInterfaceF = BasicUserInterface<float>;
+}
+
+#endif // USERINTERFACE_H
@@ -30,10 +30,21 @@ namespace ForceChain
 {   
     // Angles are reported in [0,180]
     // The order of vectors is not important: f(a,b) = f(b,a)
-    auto angleBetweenVectors(Eigen::Vector3d a, Eigen::Vector3d b)
+    // a and b are 3D vectors of one scalar type, e.g. Vector3d.
+    template <typename DerivedA, typename DerivedB>
+    auto angleBetweenVectors(const Eigen::MatrixBase<DerivedA> &a, const Eigen::MatrixBase<DerivedB> &b)
     {
         return std::atan2(a.cross(b).norm(), a.dot(b));
     }
+
+    // Cosine of angleBetweenVectors(a, b), without finding the angle.
+    // It is 1 if a or b is zero, as the angle is 0 then.
+    template <typename DerivedA, typename DerivedB>
+    auto cosineBetweenVectors(const Eigen::MatrixBase<DerivedA> &a, const Eigen::MatrixBase<DerivedB> &b)
+    {
+        auto norms = a.norm() * b.norm();
+        return norms == 0 ? decltype(norms)(1) : a.dot(b) / norms;
+    }
 }
 
 #endif
\ No newline at end of file